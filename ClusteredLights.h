@@ -0,0 +1,277 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include "ThreadPool.h"
+
+struct PointLight {
+    glm::vec3 position;
+    float radius;
+    glm::vec3 color;
+    float intensity;
+};
+
+// Clustered forward shading.
+// Пирамида видимости делится на CLUSTER_X x CLUSTER_Y плиток экрана и CLUSTER_Z
+// экспоненциальных срезов по глубине. Каждый кадр CPU (в ThreadPool, по срезам)
+// раскладывает источники света по кластерам, а компактные списки индексов
+// загружаются в buffer-текстуры. Фрагментный шейдер перебирает только свет своего кластера.
+class ClusteredLights {
+public:
+    static const int CLUSTER_X = 16;
+    static const int CLUSTER_Y = 9;
+    static const int CLUSTER_Z = 24;
+    static const int CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+    static const int MAX_LIGHTS_PER_CLUSTER = 128;
+
+    // Texture units buffer-текстур
+    static const int LIGHT_DATA_UNIT = 0;
+    static const int CLUSTER_GRID_UNIT = 1;
+    static const int LIGHT_INDEX_UNIT = 2;
+
+    ClusteredLights() = default;
+    ClusteredLights(const ClusteredLights&) = delete;
+    ClusteredLights& operator=(const ClusteredLights&) = delete;
+
+    ~ClusteredLights() {
+        destroy();
+    }
+
+    void init() {
+        glGenBuffers(3, buffers);
+        glGenTextures(3, textures);
+        const GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+        for (int i = 0; i < 3; i++) {
+            glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+            glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+            glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+            glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+        }
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        clusterLights.resize(static_cast<size_t>(CLUSTER_COUNT) * MAX_LIGHTS_PER_CLUSTER);
+        clusterCounts.resize(CLUSTER_COUNT);
+        clusterBounds.resize(CLUSTER_COUNT);
+        grid.resize(static_cast<size_t>(CLUSTER_COUNT) * 2);
+    }
+
+    // Раскладывает свет по кластерам для текущей камеры
+    void assign(const std::vector<PointLight>& lights, const glm::mat4& view, const glm::mat4& projection,
+        float nearPlane, float farPlane, ThreadPool& pool) {
+        if (projection != cachedProjection || nearPlane != zNear || farPlane != zFar) {
+            zNear = nearPlane;
+            zFar = farPlane;
+            cachedProjection = projection;
+            buildClusterBounds();
+        }
+
+        viewLights.resize(lights.size());
+        for (size_t i = 0; i < lights.size(); i++) {
+            viewLights[i] = glm::vec4(glm::vec3(view * glm::vec4(lights[i].position, 1.0f)), lights[i].radius);
+        }
+
+        // Каждый поток владеет своими срезами, поэтому запись в кластеры без блокировок
+        pool.parallelFor(CLUSTER_Z, [this](size_t firstSlice, size_t lastSlice) {
+            for (size_t slice = firstSlice; slice < lastSlice; slice++) {
+                assignSlice(static_cast<int>(slice));
+            }
+        });
+
+        // Компактный список: для кластера (offset, count) в общем массиве индексов
+        indexList.clear();
+        maxClusterLights = 0;
+        for (int cluster = 0; cluster < CLUSTER_COUNT; cluster++) {
+            uint32_t count = clusterCounts[cluster];
+            grid[cluster * 2] = static_cast<uint32_t>(indexList.size());
+            grid[cluster * 2 + 1] = count;
+            const uint32_t* source = &clusterLights[static_cast<size_t>(cluster) * MAX_LIGHTS_PER_CLUSTER];
+            indexList.insert(indexList.end(), source, source + count);
+            maxClusterLights = std::max(maxClusterLights, count);
+        }
+
+        lightData.resize(lights.size() * 8);
+        for (size_t i = 0; i < lights.size(); i++) {
+            const PointLight& light = lights[i];
+            float* texel = &lightData[i * 8];
+            texel[0] = light.position.x; texel[1] = light.position.y; texel[2] = light.position.z; texel[3] = light.radius;
+            texel[4] = light.color.r * light.intensity; texel[5] = light.color.g * light.intensity;
+            texel[6] = light.color.b * light.intensity; texel[7] = 0.0f;
+        }
+        if (indexList.empty()) indexList.push_back(0);
+        if (lightData.empty()) lightData.assign(8, 0.0f);
+
+        upload(buffers[0], lightData.data(), lightData.size() * sizeof(float));
+        upload(buffers[1], grid.data(), grid.size() * sizeof(uint32_t));
+        upload(buffers[2], indexList.data(), indexList.size() * sizeof(uint32_t));
+        lightCount = static_cast<int>(lights.size());
+    }
+
+    // Привязывает buffer-текстуры и параметры сетки к шейдеру
+    void bind(unsigned int program, int viewportWidth, int viewportHeight) const {
+        const int units[3] = { LIGHT_DATA_UNIT, CLUSTER_GRID_UNIT, LIGHT_INDEX_UNIT };
+        for (int i = 0; i < 3; i++) {
+            glActiveTexture(GL_TEXTURE0 + units[i]);
+            glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+        }
+        glActiveTexture(GL_TEXTURE0);
+
+        glUniform1i(glGetUniformLocation(program, "lightData"), LIGHT_DATA_UNIT);
+        glUniform1i(glGetUniformLocation(program, "clusterGrid"), CLUSTER_GRID_UNIT);
+        glUniform1i(glGetUniformLocation(program, "lightIndexList"), LIGHT_INDEX_UNIT);
+        glUniform3i(glGetUniformLocation(program, "clusterDims"), CLUSTER_X, CLUSTER_Y, CLUSTER_Z);
+        glUniform2f(glGetUniformLocation(program, "clusterScreenSize"),
+            static_cast<float>(viewportWidth), static_cast<float>(viewportHeight));
+        glUniform1f(glGetUniformLocation(program, "clusterNear"), zNear);
+        glUniform1f(glGetUniformLocation(program, "clusterSliceScale"), CLUSTER_Z / std::log(zFar / zNear));
+        glUniform1i(glGetUniformLocation(program, "pointLightCount"), lightCount);
+    }
+
+    uint32_t maxLightsInCluster() const { return maxClusterLights; }
+    size_t indexCount() const { return indexList.size(); }
+
+    void destroy() {
+        if (buffers[0] != 0) glDeleteBuffers(3, buffers);
+        if (textures[0] != 0) glDeleteTextures(3, textures);
+        for (int i = 0; i < 3; i++) buffers[i] = textures[i] = 0;
+    }
+
+private:
+    struct ClusterBox {
+        glm::vec3 min;
+        glm::vec3 max;
+    };
+
+    unsigned int buffers[3] = { 0, 0, 0 };
+    unsigned int textures[3] = { 0, 0, 0 };
+
+    glm::mat4 cachedProjection = glm::mat4(0.0f);
+    float zNear = 0.1f;
+    float zFar = 100.0f;
+    int lightCount = 0;
+    uint32_t maxClusterLights = 0;
+
+    std::vector<ClusterBox> clusterBounds;
+    std::vector<glm::vec4> viewLights;              // центр в view space + радиус
+    std::vector<uint32_t> clusterLights;            // MAX_LIGHTS_PER_CLUSTER слотов на кластер
+    std::vector<uint32_t> clusterCounts;
+    std::vector<uint32_t> grid;                     // (offset, count) на кластер
+    std::vector<uint32_t> indexList;
+    std::vector<float> lightData;
+
+    float sliceDepth(int slice) const {
+        return zNear * std::pow(zFar / zNear, static_cast<float>(slice) / CLUSTER_Z);
+    }
+
+    static int clusterIndex(int x, int y, int z) {
+        return (z * CLUSTER_Y + y) * CLUSTER_X + x;
+    }
+
+    // AABB кластеров в view space; пересчитывается только при смене проекции
+    void buildClusterBounds() {
+        float scaleX = 1.0f / cachedProjection[0][0];
+        float scaleY = 1.0f / cachedProjection[1][1];
+        for (int z = 0; z < CLUSTER_Z; z++) {
+            float nearDepth = sliceDepth(z);
+            float farDepth = sliceDepth(z + 1);
+            for (int y = 0; y < CLUSTER_Y; y++) {
+                float ndcY0 = -1.0f + 2.0f * y / CLUSTER_Y;
+                float ndcY1 = -1.0f + 2.0f * (y + 1) / CLUSTER_Y;
+                for (int x = 0; x < CLUSTER_X; x++) {
+                    float ndcX0 = -1.0f + 2.0f * x / CLUSTER_X;
+                    float ndcX1 = -1.0f + 2.0f * (x + 1) / CLUSTER_X;
+
+                    ClusterBox box{ glm::vec3(1e30f), glm::vec3(-1e30f) };
+                    const float depths[2] = { nearDepth, farDepth };
+                    for (float depth : depths) {
+                        const float xs[2] = { ndcX0 * depth * scaleX, ndcX1 * depth * scaleX };
+                        const float ys[2] = { ndcY0 * depth * scaleY, ndcY1 * depth * scaleY };
+                        for (float px : xs) {
+                            for (float py : ys) {
+                                glm::vec3 corner(px, py, -depth);
+                                box.min = glm::min(box.min, corner);
+                                box.max = glm::max(box.max, corner);
+                            }
+                        }
+                    }
+                    clusterBounds[clusterIndex(x, y, z)] = box;
+                }
+            }
+        }
+    }
+
+    int tileFromNdc(float ndc, int tiles) const {
+        int tile = static_cast<int>(std::floor((ndc * 0.5f + 0.5f) * tiles));
+        return std::max(0, std::min(tiles - 1, tile));
+    }
+
+    void assignSlice(int z) {
+        float nearDepth = sliceDepth(z);
+        float farDepth = sliceDepth(z + 1);
+        for (int y = 0; y < CLUSTER_Y; y++) {
+            for (int x = 0; x < CLUSTER_X; x++) clusterCounts[clusterIndex(x, y, z)] = 0;
+        }
+
+        float scaleX = cachedProjection[0][0];
+        float scaleY = cachedProjection[1][1];
+
+        for (size_t i = 0; i < viewLights.size(); i++) {
+            glm::vec3 center(viewLights[i]);
+            float radius = viewLights[i].w;
+            float depth = -center.z;
+            if (depth + radius < nearDepth || depth - radius > farDepth) continue;
+
+            // Консервативный прямоугольник плиток: проекция AABB сферы, обрезанного по срезу
+            float minDepth = std::max(depth - radius, nearDepth);
+            float maxDepth = std::min(depth + radius, farDepth);
+            int x0 = 0, x1 = CLUSTER_X - 1, y0 = 0, y1 = CLUSTER_Y - 1;
+            if (minDepth > 0.0f) {
+                float ndcMinX = 1e30f, ndcMaxX = -1e30f, ndcMinY = 1e30f, ndcMaxY = -1e30f;
+                const float depths[2] = { minDepth, maxDepth };
+                const float xs[2] = { center.x - radius, center.x + radius };
+                const float ys[2] = { center.y - radius, center.y + radius };
+                for (float d : depths) {
+                    for (float px : xs) {
+                        ndcMinX = std::min(ndcMinX, px * scaleX / d);
+                        ndcMaxX = std::max(ndcMaxX, px * scaleX / d);
+                    }
+                    for (float py : ys) {
+                        ndcMinY = std::min(ndcMinY, py * scaleY / d);
+                        ndcMaxY = std::max(ndcMaxY, py * scaleY / d);
+                    }
+                }
+                if (ndcMaxX < -1.0f || ndcMinX > 1.0f || ndcMaxY < -1.0f || ndcMinY > 1.0f) continue;
+                x0 = tileFromNdc(ndcMinX, CLUSTER_X);
+                x1 = tileFromNdc(ndcMaxX, CLUSTER_X);
+                y0 = tileFromNdc(ndcMinY, CLUSTER_Y);
+                y1 = tileFromNdc(ndcMaxY, CLUSTER_Y);
+            }
+
+            float radius2 = radius * radius;
+            for (int y = y0; y <= y1; y++) {
+                for (int x = x0; x <= x1; x++) {
+                    int cluster = clusterIndex(x, y, z);
+                    const ClusterBox& box = clusterBounds[cluster];
+                    glm::vec3 closest = glm::clamp(center, box.min, box.max);
+                    glm::vec3 delta = closest - center;
+                    if (glm::dot(delta, delta) > radius2) continue;
+
+                    uint32_t& count = clusterCounts[cluster];
+                    if (count < MAX_LIGHTS_PER_CLUSTER) {
+                        clusterLights[static_cast<size_t>(cluster) * MAX_LIGHTS_PER_CLUSTER + count++] = static_cast<uint32_t>(i);
+                    }
+                }
+            }
+        }
+    }
+
+    static void upload(unsigned int buffer, const void* data, size_t bytes) {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, bytes, nullptr, GL_STREAM_DRAW); // orphaning
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, data);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+};
@@ -0,0 +1,238 @@
+#pragma once
+#include <glad/glad.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <algorithm>
+
+// Динамическое разрешение.
+// Кадр рисуется во внеэкранный framebuffer размером с окно, но только в его левый нижний
+// угол renderWidth() x renderHeight(); затем этот угол растягивается на окно одним
+// glBlitFramebuffer с линейной фильтрацией. При смене масштаба ничего не пересоздаётся.
+// Время GPU измеряется кольцом запросов GL_TIME_ELAPSED (результат читается через
+// несколько кадров, без ожидания), время CPU - от beginFrame до endFrame. Стоимостью кадра
+// считается большее из двух: при программной растеризации заливка идёт на CPU.
+// Раз в adjustInterval секунд масштаб подбирается так, чтобы стоимость уложилась в бюджет:
+// стоимость заливки пропорциональна числу пикселей, то есть квадрату масштаба.
+// После каждого снижения два замера дают модель cost = fixed + fill * scale^2; если
+// не зависящая от разрешения часть fixed сама выходит за бюджет, снижение не поможет:
+// масштаб возвращается и следующие holdSeconds секунд не снижается.
+class DynamicResolution {
+public:
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    float scaleStep = 0.05f;        // масштаб меняется шагами, чтобы не дрожать
+    float adjustInterval = 0.5f;    // секунд между решениями
+    float lowerThreshold = 0.95f;   // доля бюджета, выше которой масштаб снижается
+    float raiseThreshold = 0.75f;   // доля бюджета, ниже которой масштаб повышается
+    float holdSeconds = 5.0f;       // пауза после снижения, которое не помогло бы
+
+    DynamicResolution() = default;
+    DynamicResolution(const DynamicResolution&) = delete;
+    DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+    ~DynamicResolution() {
+        destroy();
+    }
+
+    // frameBudgetMs = 0: рисовать сразу в окно в полном разрешении
+    bool init(int width, int height, float frameBudgetMs) {
+        windowWidth = width;
+        windowHeight = height;
+        budgetMs = frameBudgetMs;
+        currentScale = 1.0f;
+        startTime = lastAdjustTime = holdUntil = std::chrono::steady_clock::now();
+        framesSinceChange = 0;
+        probeScale = 0.0f;
+        if (budgetMs <= 0.0f) return true;
+
+        glGenFramebuffers(1, &framebuffer);
+        glGenRenderbuffers(2, renderbuffers);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+        GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "ERROR::DYNAMIC_RESOLUTION::FRAMEBUFFER_INCOMPLETE: 0x" << std::hex << status << std::dec << std::endl;
+            destroy();
+            budgetMs = 0.0f;
+            return false;
+        }
+
+        glGenQueries(QUERY_COUNT, queries);
+        std::cout << "Dynamic resolution: budget " << budgetMs << " ms, scale "
+            << minScale << ".." << maxScale << std::endl;
+        return true;
+    }
+
+    bool enabled() const { return framebuffer != 0; }
+    float scale() const { return currentScale; }
+    int renderWidth() const { return std::max(1, static_cast<int>(std::lround(windowWidth * currentScale))); }
+    int renderHeight() const { return std::max(1, static_cast<int>(std::lround(windowHeight * currentScale))); }
+    double gpuMilliseconds() const { return gpuMs; }
+    double cpuMilliseconds() const { return cpuMs; }
+
+    // Привязывает цель рендера текущего масштаба и начинает замер кадра
+    void beginFrame() {
+        frameStart = std::chrono::steady_clock::now();
+        if (!enabled()) {
+            glViewport(0, 0, windowWidth, windowHeight);
+            return;
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glViewport(0, 0, renderWidth(), renderHeight());
+
+        GLuint query = queries[queryHead % QUERY_COUNT];
+        if (queryHead - queryTail < QUERY_COUNT) {
+            glBeginQuery(GL_TIME_ELAPSED, query);
+            queryActive = true;
+        }
+    }
+
+    // Растягивает кадр на окно, собирает замеры и при необходимости меняет масштаб
+    void endFrame() {
+        if (!enabled()) return;
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, renderWidth(), renderHeight(), 0, 0, windowWidth, windowHeight,
+            GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        if (queryActive) {
+            glEndQuery(GL_TIME_ELAPSED);
+            queryActive = false;
+            queryHead++;
+        }
+        collectQueries();
+
+        // Первые кадры после смены масштаба (и после старта) ещё несут старую нагрузку
+        framesSinceChange++;
+        if (framesSinceChange > SETTLE_FRAMES) {
+            double cpuSample = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+            cpuMs = cpuMs == 0.0 ? cpuSample : cpuMs * (1.0 - SMOOTHING) + cpuSample * SMOOTHING;
+        }
+
+        adjust();
+    }
+
+    void destroy() {
+        if (framebuffer != 0) glDeleteFramebuffers(1, &framebuffer);
+        if (renderbuffers[0] != 0) glDeleteRenderbuffers(2, renderbuffers);
+        if (queries[0] != 0) glDeleteQueries(QUERY_COUNT, queries);
+        framebuffer = 0;
+        renderbuffers[0] = renderbuffers[1] = 0;
+        for (GLuint& query : queries) query = 0;
+        queryHead = queryTail = 0;
+        queryActive = false;
+    }
+
+private:
+    static const unsigned int QUERY_COUNT = 4;
+    static constexpr double SMOOTHING = 0.2;    // вес нового замера в скользящем среднем
+    static const int SETTLE_FRAMES = QUERY_COUNT + 1;
+    static const int MIN_SAMPLES = 8;
+
+    GLuint framebuffer = 0;
+    GLuint renderbuffers[2] = { 0, 0 };     // цвет, глубина
+    GLuint queries[QUERY_COUNT] = { 0, 0, 0, 0 };
+    unsigned int queryHead = 0;             // следующий запрос для начала
+    unsigned int queryTail = 0;             // самый старый незавершённый запрос
+    bool queryActive = false;
+
+    int windowWidth = 0;
+    int windowHeight = 0;
+    float budgetMs = 0.0f;
+    float currentScale = 1.0f;
+    double gpuMs = 0.0;
+    double cpuMs = 0.0;
+    std::chrono::steady_clock::time_point startTime;
+    std::chrono::steady_clock::time_point lastAdjustTime;
+    std::chrono::steady_clock::time_point frameStart;
+    std::chrono::steady_clock::time_point holdUntil;
+    int framesSinceChange = 0;
+    float probeScale = 0.0f;        // масштаб до последнего снижения (0 - проверять нечего)
+    double probeCost = 0.0;         // стоимость кадра до него
+
+    // Читает все готовые результаты, не дожидаясь GPU
+    void collectQueries() {
+        while (queryTail != queryHead) {
+            GLuint query = queries[queryTail % QUERY_COUNT];
+            GLint available = 0;
+            glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) break;
+
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+            queryTail++;
+            if (framesSinceChange >= SETTLE_FRAMES) {
+                double sample = nanoseconds / 1.0e6;
+                gpuMs = gpuMs == 0.0 ? sample : gpuMs * (1.0 - SMOOTHING) + sample * SMOOTHING;
+            }
+        }
+    }
+
+    void adjust() {
+        auto now = std::chrono::steady_clock::now();
+        if (framesSinceChange < SETTLE_FRAMES + MIN_SAMPLES || cpuMs <= 0.0) return;
+        if (std::chrono::duration<float>(now - lastAdjustTime).count() < adjustInterval) return;
+        lastAdjustTime = now;
+
+        double cost = std::max(gpuMs, cpuMs);
+        if (probeScale > 0.0f) {
+            float previous = probeScale;
+            probeScale = 0.0f;
+            double fill = (probeCost - cost) / (previous * previous - currentScale * currentScale);
+            double fixedCost = cost - fill * currentScale * currentScale;
+            if (fixedCost > budgetMs * lowerThreshold) {
+                holdUntil = now + std::chrono::milliseconds(static_cast<int>(holdSeconds * 1000.0f));
+                setScale(previous, cost, now, "resolution-independent cost is over budget");
+                return;
+            }
+        }
+
+        float target = currentScale;
+        if (cost > budgetMs * lowerThreshold) {
+            if (now < holdUntil) return;
+            target = currentScale * std::sqrt(static_cast<float>(budgetMs * raiseThreshold / cost));
+        }
+        else if (cost < budgetMs * raiseThreshold) {
+            target = currentScale * std::sqrt(static_cast<float>(budgetMs * lowerThreshold / cost));
+            // Повышение осторожное: не больше одного шага за раз
+            target = std::min(target, currentScale + scaleStep);
+        }
+
+        target = std::round(target / scaleStep) * scaleStep;
+        target = std::min(maxScale, std::max(minScale, target));
+        if (std::fabs(target - currentScale) < scaleStep * 0.5f) return;
+
+        if (target < currentScale) {
+            probeScale = currentScale;
+            probeCost = cost;
+        }
+        setScale(target, cost, now, target < currentScale ? "over budget" : "under budget");
+    }
+
+    // Одна строка на изменение, чтобы журнал можно было разобрать
+    void setScale(float target, double cost, std::chrono::steady_clock::time_point now, const char* reason) {
+        float seconds = std::chrono::duration<float>(now - startTime).count();
+        char line[256];
+        std::snprintf(line, sizeof(line),
+            "Render scale %.2f -> %.2f at %.1f s: gpu %.2f ms, cpu %.2f ms, cost %.2f ms, budget %.2f ms, %s",
+            currentScale, target, seconds, gpuMs, cpuMs, cost, budgetMs, reason);
+        currentScale = target;
+        std::cout << line << " (" << renderWidth() << "x" << renderHeight() << ")" << std::endl;
+
+        framesSinceChange = 0;
+        gpuMs = cpuMs = 0.0;
+    }
+};
@@ -0,0 +1,81 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Линейный аллокатор на один кадр: выделение - сдвиг указателя, освобождения по одному нет,
+// reset() в начале кадра возвращает всю память разом.
+// Если блока не хватило, добавляется ещё один; на следующем reset() блоки сливаются
+// в один размером с пиковое потребление, так что в установившемся режиме кадр
+// обходится без обращений к куче. Память живёт до следующего reset(), поэтому
+// указатели из арены нельзя хранить между кадрами. Только для тривиально
+// разрушаемых типов: деструкторы не вызываются.
+class FrameArena {
+public:
+    explicit FrameArena(size_t initialCapacity = 64 * 1024) {
+        addBlock(initialCapacity);
+    }
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+        Block* block = &blocks.back();
+        uintptr_t base = reinterpret_cast<uintptr_t>(block->data.get());
+        size_t offset = (base + block->used + alignment - 1) / alignment * alignment - base;
+        if (offset + bytes > block->size) {
+            addBlock(std::max(block->size * 2, bytes + alignment));
+            block = &blocks.back();
+            base = reinterpret_cast<uintptr_t>(block->data.get());
+            offset = (base + alignment - 1) / alignment * alignment - base;
+        }
+        block->used = offset + bytes;
+        used += bytes;
+        return block->data.get() + offset;
+    }
+
+    template <typename T>
+    T* allocate(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "FrameArena does not run destructors");
+        return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    void reset() {
+        if (used > highWater) highWater = used;
+        if (blocks.size() > 1) {
+            size_t total = 0;
+            for (const Block& block : blocks) total += block.size;
+            blocks.clear();
+            addBlock(total);
+        }
+        blocks.back().used = 0;
+        used = 0;
+    }
+
+    size_t bytesUsed() const { return used; }
+    size_t peakBytes() const { return used > highWater ? used : highWater; }
+
+    size_t capacity() const {
+        size_t total = 0;
+        for (const Block& block : blocks) total += block.size;
+        return total;
+    }
+
+private:
+    struct Block {
+        std::unique_ptr<unsigned char[]> data;
+        size_t size;
+        size_t used;
+    };
+
+    std::vector<Block> blocks;
+    size_t used = 0;
+    size_t highWater = 0;
+
+    void addBlock(size_t size) {
+        blocks.push_back({ std::unique_ptr<unsigned char[]>(new unsigned char[size]), size, 0 });
+    }
+};
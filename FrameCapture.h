@@ -0,0 +1,371 @@
+#pragma once
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Запись кадров из framebuffer-объекта в последовательность файлов.
+// Кадр рисуется в собственный FBO; glReadPixels копирует его в очередной PBO кольца и
+// ставит fence - вызов возвращается сразу. Готовые PBO (fence сработал) отображаются и
+// копируются в буфер кадра, который кодирует и пишет на диск фоновый поток.
+// Рендер ждёт только если все PBO ещё в работе или очередь кодировщика переполнена.
+class FrameCapture {
+public:
+    enum class Format {
+        Raw,    // RGBA8 построчно сверху вниз, без заголовка
+        Png     // RGBA8 PNG без сжатия (stored deflate)
+    };
+
+    static const int PBO_COUNT = 3;
+    static const size_t MAX_QUEUED_FRAMES = 8;
+
+    FrameCapture() = default;
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    ~FrameCapture() {
+        finish();
+    }
+
+    // Кадры пишутся в outputDirectory/frame_00000.png (или .rgba); каталог должен существовать
+    bool init(int frameWidth, int frameHeight, const std::string& outputDirectory, Format outputFormat) {
+        width = frameWidth;
+        height = frameHeight;
+        directory = outputDirectory;
+        format = outputFormat;
+        frameBytes = static_cast<size_t>(width) * height * 4;
+
+        glGenFramebuffers(1, &framebuffer);
+        glGenRenderbuffers(2, renderbuffers);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+        GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "ERROR::FRAME_CAPTURE::FRAMEBUFFER_INCOMPLETE: 0x" << std::hex << status << std::dec << std::endl;
+            release();
+            return false;
+        }
+
+        glGenBuffers(PBO_COUNT, pbos);
+        for (GLuint pbo : pbos) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+            glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes, nullptr, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        stopping = false;
+        startTime = lastReportTime = std::chrono::steady_clock::now();
+        encoder = std::thread(&FrameCapture::encoderLoop, this);
+        std::cout << "Capturing " << width << "x" << height << " frames to " << directory
+            << (format == Format::Png ? " as PNG" : " as raw RGBA") << std::endl;
+        return true;
+    }
+
+    // Привязывает FBO кадра; вызывать перед отрисовкой
+    void beginFrame() {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glViewport(0, 0, width, height);
+    }
+
+    // Запускает чтение кадра в PBO и отдаёт кодировщику уже прочитанные
+    void endFrame() {
+        if (pending == PBO_COUNT) retire(true);
+
+        int slot = (first + pending) % PBO_COUNT;
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[slot]);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        frameNumbers[slot] = framesRendered++;
+        pending++;
+        glFlush();
+
+        while (pending > 0 && retire(false)) {
+        }
+        report(false);
+    }
+
+    // Дочитывает все PBO, дожидается кодировщика и печатает итог
+    void finish() {
+        if (framebuffer == 0) return;
+        while (pending > 0) retire(true);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        queueChanged.notify_all();
+        if (encoder.joinable()) encoder.join();
+
+        report(true);
+        release();
+    }
+
+private:
+    struct Frame {
+        int number;
+        std::vector<uint8_t> pixels;    // снизу вверх, как отдаёт glReadPixels
+    };
+
+    int width = 0;
+    int height = 0;
+    size_t frameBytes = 0;
+    std::string directory;
+    Format format = Format::Png;
+
+    GLuint framebuffer = 0;
+    GLuint renderbuffers[2] = { 0, 0 };     // цвет, глубина
+    GLuint pbos[PBO_COUNT] = { 0, 0, 0 };
+    GLsync fences[PBO_COUNT] = { nullptr, nullptr, nullptr };
+    int frameNumbers[PBO_COUNT] = { 0, 0, 0 };
+    int first = 0;      // самый старый PBO в работе
+    int pending = 0;    // PBO в работе
+
+    std::thread encoder;
+    std::mutex mutex;
+    std::condition_variable queueChanged;
+    std::deque<Frame> queue;
+    std::vector<std::vector<uint8_t>> freeBuffers;  // возвращённые кодировщиком, чтобы не выделять память каждый кадр
+    bool stopping = false;
+    int framesRendered = 0;
+    int framesWritten = 0;
+    bool writeFailed = false;
+
+    std::chrono::steady_clock::time_point startTime;
+    std::chrono::steady_clock::time_point lastReportTime;
+    int reportedRendered = 0;
+    int reportedWritten = 0;
+
+    // Забирает самый старый PBO; wait = false - только если fence уже сработал
+    bool retire(bool wait) {
+        int slot = first;
+        GLenum result = glClientWaitSync(fences[slot], wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+            wait ? GL_TIMEOUT_IGNORED : 0);
+        if (result == GL_TIMEOUT_EXPIRED) return false;
+        glDeleteSync(fences[slot]);
+        fences[slot] = nullptr;
+
+        Frame frame;
+        frame.number = frameNumbers[slot];
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            queueChanged.wait(lock, [this] { return queue.size() < MAX_QUEUED_FRAMES; });
+            if (!freeBuffers.empty()) {
+                frame.pixels = std::move(freeBuffers.back());
+                freeBuffers.pop_back();
+            }
+        }
+        frame.pixels.resize(frameBytes);
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[slot]);
+        const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frameBytes, GL_MAP_READ_BIT);
+        if (mapped) {
+            std::memcpy(frame.pixels.data(), mapped, frameBytes);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        first = (first + 1) % PBO_COUNT;
+        pending--;
+        if (!mapped) {
+            std::cerr << "ERROR::FRAME_CAPTURE::MAP_FAILED: frame " << frame.number << std::endl;
+            return true;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(std::move(frame));
+        }
+        queueChanged.notify_all();
+        return true;
+    }
+
+    void encoderLoop() {
+        std::vector<uint8_t> rows(frameBytes);
+        for (;;) {
+            Frame frame;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                queueChanged.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (queue.empty()) return;
+                frame = std::move(queue.front());
+                queue.pop_front();
+            }
+            queueChanged.notify_all();
+
+            // Строки OpenGL идут снизу вверх, в файле - сверху вниз
+            size_t stride = static_cast<size_t>(width) * 4;
+            for (int y = 0; y < height; y++) {
+                std::memcpy(&rows[y * stride], &frame.pixels[(height - 1 - y) * stride], stride);
+            }
+
+            char name[32];
+            std::snprintf(name, sizeof(name), "frame_%05d.%s", frame.number, format == Format::Png ? "png" : "rgba");
+            std::string path = directory + "/" + name;
+            bool written = format == Format::Png ? writePng(path, rows) : writeRaw(path, rows);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (written) framesWritten++;
+            else if (!writeFailed) {
+                std::cerr << "ERROR::FRAME_CAPTURE::CANNOT_WRITE: " << path << std::endl;
+                writeFailed = true;
+            }
+            freeBuffers.push_back(std::move(frame.pixels));
+        }
+    }
+
+    bool writeRaw(const std::string& path, const std::vector<uint8_t>& rows) const {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(rows.data()), rows.size());
+        return static_cast<bool>(file);
+    }
+
+    // PNG без сжатия: IDAT содержит zlib-поток из stored-блоков deflate
+    bool writePng(const std::string& path, const std::vector<uint8_t>& rows) const {
+        size_t stride = static_cast<size_t>(width) * 4;
+        std::vector<uint8_t> raw;
+        raw.reserve((stride + 1) * height);
+        for (int y = 0; y < height; y++) {
+            raw.push_back(0); // фильтр строки: None
+            raw.insert(raw.end(), rows.begin() + y * stride, rows.begin() + (y + 1) * stride);
+        }
+
+        std::vector<uint8_t> zlib = { 0x78, 0x01 };
+        zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+        for (size_t offset = 0;;) {
+            size_t length = std::min<size_t>(65535, raw.size() - offset);
+            bool last = offset + length == raw.size();
+            zlib.push_back(last ? 1 : 0);
+            zlib.push_back(length & 0xFF);
+            zlib.push_back((length >> 8) & 0xFF);
+            zlib.push_back(~length & 0xFF);
+            zlib.push_back((~length >> 8) & 0xFF);
+            zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+            offset += length;
+            if (last) break;
+        }
+        appendBigEndian(zlib, adler32(raw));
+
+        std::vector<uint8_t> header;
+        appendBigEndian(header, static_cast<uint32_t>(width));
+        appendBigEndian(header, static_cast<uint32_t>(height));
+        header.insert(header.end(), { 8, 6, 0, 0, 0 }); // 8 бит, RGBA, deflate, без фильтра, без interlace
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+        writeChunk(file, "IHDR", header);
+        writeChunk(file, "IDAT", zlib);
+        writeChunk(file, "IEND", {});
+        return static_cast<bool>(file);
+    }
+
+    static void appendBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+        out.push_back(value >> 24);
+        out.push_back((value >> 16) & 0xFF);
+        out.push_back((value >> 8) & 0xFF);
+        out.push_back(value & 0xFF);
+    }
+
+    static void writeChunk(std::ofstream& file, const char* type, const std::vector<uint8_t>& data) {
+        std::vector<uint8_t> chunk;
+        appendBigEndian(chunk, static_cast<uint32_t>(data.size()));
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), data.begin(), data.end());
+        uint32_t crc = crc32(chunk.data() + 4, chunk.size() - 4);
+        appendBigEndian(chunk, crc);
+        file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+    }
+
+    static uint32_t crc32(const uint8_t* data, size_t size) {
+        static uint32_t table[256];
+        static bool tableReady = [] {
+            for (uint32_t n = 0; n < 256; n++) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                table[n] = c;
+            }
+            return true;
+        }();
+        (void)tableReady;
+
+        uint32_t c = 0xFFFFFFFFu;
+        for (size_t i = 0; i < size; i++) c = table[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+        return c ^ 0xFFFFFFFFu;
+    }
+
+    static uint32_t adler32(const std::vector<uint8_t>& data) {
+        uint32_t a = 1, b = 0;
+        for (size_t i = 0; i < data.size(); ) {
+            // 5552 - наибольший блок, в котором сумма не переполняет 32 бита
+            size_t end = std::min(data.size(), i + 5552);
+            for (; i < end; i++) {
+                a += data[i];
+                b += a;
+            }
+            a %= 65521;
+            b %= 65521;
+        }
+        return (b << 16) | a;
+    }
+
+    // Пропускная способность раз в две секунды и итог в конце
+    void report(bool final) {
+        auto now = std::chrono::steady_clock::now();
+        double interval = std::chrono::duration<double>(now - lastReportTime).count();
+        if (!final && interval < 2.0) return;
+
+        int written;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            written = framesWritten;
+        }
+        if (final) {
+            double total = std::chrono::duration<double>(now - startTime).count();
+            std::cout << "Captured " << framesRendered << " frames, wrote " << written << " in " << total << " s ("
+                << (total > 0.0 ? written / total : 0.0) << " fps)" << std::endl;
+        }
+        else {
+            std::cout << "Capture: " << (framesRendered - reportedRendered) / interval << " fps rendered, "
+                << (written - reportedWritten) / interval << " fps written" << std::endl;
+        }
+        reportedRendered = framesRendered;
+        reportedWritten = written;
+        lastReportTime = now;
+    }
+
+    void release() {
+        for (GLsync& fence : fences) {
+            if (fence) glDeleteSync(fence);
+            fence = nullptr;
+        }
+        if (pbos[0] != 0) glDeleteBuffers(PBO_COUNT, pbos);
+        if (framebuffer != 0) glDeleteFramebuffers(1, &framebuffer);
+        if (renderbuffers[0] != 0) glDeleteRenderbuffers(2, renderbuffers);
+        for (GLuint& pbo : pbos) pbo = 0;
+        framebuffer = 0;
+        renderbuffers[0] = renderbuffers[1] = 0;
+        pending = first = 0;
+    }
+};
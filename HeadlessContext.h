@@ -0,0 +1,96 @@
+#pragma once
+// Собирается только с -DENABLE_HEADLESS (нужна libEGL)
+#ifdef ENABLE_HEADLESS
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstring>
+#include <iostream>
+
+// Контекст OpenGL 3.3 core без окна и без дисплея: EGL на платформе surfaceless
+// (Mesa llvmpipe на машинах без GPU или драйвер GPU). Поверхности нет,
+// поэтому рисовать можно только во framebuffer-объекты (см. FrameCapture).
+class HeadlessContext {
+public:
+    HeadlessContext() = default;
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    ~HeadlessContext() {
+        destroy();
+    }
+
+    bool create() {
+        auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (getPlatformDisplay) {
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        }
+        if (display == EGL_NO_DISPLAY) {
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        }
+
+        EGLint major = 0, minor = 0;
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+            return fail("EGL_INITIALIZE");
+        }
+        const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+        if (!extensions || !std::strstr(extensions, "EGL_KHR_surfaceless_context")) {
+            std::cerr << "ERROR::HEADLESS::NO_SURFACELESS_CONTEXT" << std::endl;
+            destroy();
+            return false;
+        }
+        if (!eglBindAPI(EGL_OPENGL_API)) {
+            return fail("EGL_BIND_API");
+        }
+
+        const EGLint configAttributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+        EGLConfig config = nullptr;
+        EGLint configCount = 0;
+        eglChooseConfig(display, configAttributes, &config, 1, &configCount);
+
+        const EGLint contextAttributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 3,
+            EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        // Без подходящей конфигурации - контекст без неё (EGL_KHR_no_config_context)
+        context = eglCreateContext(display, configCount > 0 ? config : nullptr, EGL_NO_CONTEXT, contextAttributes);
+        if (context == EGL_NO_CONTEXT) {
+            return fail("EGL_CREATE_CONTEXT");
+        }
+        if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+            return fail("EGL_MAKE_CURRENT");
+        }
+
+        std::cout << "Headless EGL " << major << "." << minor << " context ("
+            << eglQueryString(display, EGL_VENDOR) << ")" << std::endl;
+        return true;
+    }
+
+    void destroy() {
+        if (display == EGL_NO_DISPLAY) return;
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (context != EGL_NO_CONTEXT) eglDestroyContext(display, context);
+        eglTerminate(display);
+        context = EGL_NO_CONTEXT;
+        display = EGL_NO_DISPLAY;
+    }
+
+    // Загрузчик функций для glad, StreamBuffer и кэша шейдеров
+    static void* getProcAddress(const char* name) {
+        return reinterpret_cast<void*>(eglGetProcAddress(name));
+    }
+
+private:
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+
+    bool fail(const char* step) {
+        std::cerr << "ERROR::HEADLESS::" << step << "_FAILED: 0x" << std::hex << eglGetError() << std::dec << std::endl;
+        destroy();
+        return false;
+    }
+};
+#endif
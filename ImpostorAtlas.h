@@ -0,0 +1,237 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include "Shader.h"
+#include "StreamBuffer.h"
+
+// Импостеры дальних персонажей.
+// При запуске POSE_COUNT поз цикла ходьбы снимаются ортографической камерой с VIEW_COUNT
+// сторон в атлас: ячейка - ракурс по горизонтали, поза по вертикали. Снимаются цвет (альфа -
+// покрытие) и нормаль в системе персонажа, так что импостер освещается так же, как геометрия.
+// Вдали персонаж - один четырёхугольник, повёрнутый к камере; все импостеры кадра рисуются
+// одним instanced-вызовом, данные экземпляров идут через StreamBuffer.
+// Переход с геометрией - дизеринг по матрице Байера: геометрия оставляет пиксели, где порог
+// меньше 1 - fade, импостер - остальные, поэтому вместе они закрывают силуэт ровно один раз.
+class ImpostorAtlas {
+public:
+    static const int POSE_COUNT = 8;
+    static const int VIEW_COUNT = 8;
+    static const int CELL_SIZE = 128;
+
+    ImpostorAtlas() = default;
+    ImpostorAtlas(const ImpostorAtlas&) = delete;
+    ImpostorAtlas& operator=(const ImpostorAtlas&) = delete;
+
+    ~ImpostorAtlas() {
+        destroy();
+    }
+
+    bool init(StreamBuffer::LoadProc loader, int maxInstanceCount) {
+        if (!shader.load("shaders/impostor_vertex.glsl", "shaders/impostor_fragment.glsl")) {
+            std::cerr << "ERROR::IMPOSTOR::SHADER_LOAD_FAILED" << std::endl;
+            return false;
+        }
+        maxInstances = maxInstanceCount;
+        if (!instances.create(GL_ARRAY_BUFFER, sizeof(Instance) * maxInstances, sizeof(glm::vec4), loader)) {
+            std::cerr << "ERROR::IMPOSTOR::INSTANCE_BUFFER_FAILED" << std::endl;
+            return false;
+        }
+
+        const int width = CELL_SIZE * VIEW_COUNT, height = CELL_SIZE * POSE_COUNT;
+        glGenTextures(2, textures);
+        for (GLuint texture : textures) {
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            // Глубже 8x8 пикселей на ячейку мипы смешивали бы соседние ячейки
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 4);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        // Углы четырёхугольника: x по ширине от центра, y от низа кадра
+        const float corners[] = { -0.5f, 0.0f, 0.5f, 0.0f, -0.5f, 1.0f, 0.5f, 1.0f };
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &quadVBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribDivisor(1, 1);
+        glEnableVertexAttribArray(2);
+        glVertexAttribDivisor(2, 1);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        shader.use();
+        shader.setInt("albedoAtlas", 0);
+        shader.setInt("normalAtlas", 1);
+        glUniform2i(glGetUniformLocation(shader.ID, "atlasGrid"), VIEW_COUNT, POSE_COUNT);
+        return true;
+    }
+
+    // Кадр съёмки в системе персонажа: halfWidth по горизонтали от оси, bottom..top по высоте.
+    // drawPose рисует позу pose (фаза pose * 2pi / POSE_COUNT) персонажа в начале координат
+    // без поворота шейдером bakeShader, у которого уже выставлены view и projection ячейки
+    bool bake(Shader& bakeShader, float halfWidth, float bottom, float top, const std::function<void(int pose)>& drawPose) {
+        auto start = std::chrono::steady_clock::now();
+        frameHalfWidth = halfWidth;
+        frameBottom = bottom;
+        frameTop = top;
+
+        const int width = CELL_SIZE * VIEW_COUNT, height = CELL_SIZE * POSE_COUNT;
+        GLuint framebuffer = 0, depth = 0;
+        glGenFramebuffers(1, &framebuffer);
+        glGenRenderbuffers(1, &depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[0], 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, textures[1], 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+        const GLenum attachments[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, attachments);
+
+        GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        if (status == GL_FRAMEBUFFER_COMPLETE) {
+            glViewport(0, 0, width, height);
+            glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            float centerY = (bottom + top) * 0.5f;
+            glm::mat4 projection = glm::ortho(-halfWidth, halfWidth, bottom - centerY, top - centerY, 0.1f, 2.0f * halfWidth + 0.2f);
+            for (int pose = 0; pose < POSE_COUNT; pose++) {
+                for (int view = 0; view < VIEW_COUNT; view++) {
+                    // Камера ракурса view смотрит на ось персонажа со стороны угла view * 2pi / VIEW_COUNT
+                    float angle = view * glm::two_pi<float>() / VIEW_COUNT;
+                    glm::vec3 direction(std::sin(angle), 0.0f, std::cos(angle));
+                    glm::vec3 center(0.0f, centerY, 0.0f);
+                    bakeShader.use();
+                    bakeShader.setMat4("view", glm::lookAt(center + direction * (halfWidth + 0.1f), center, glm::vec3(0, 1, 0)));
+                    bakeShader.setMat4("projection", projection);
+                    glViewport(view * CELL_SIZE, pose * CELL_SIZE, CELL_SIZE, CELL_SIZE);
+                    drawPose(pose);
+                }
+            }
+        }
+        else {
+            std::cerr << "ERROR::IMPOSTOR::FRAMEBUFFER_INCOMPLETE: 0x" << std::hex << status << std::dec << std::endl;
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(1, &depth);
+        if (status != GL_FRAMEBUFFER_COMPLETE) return false;
+
+        for (GLuint texture : textures) {
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        baked = true;
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Impostor atlas: " << POSE_COUNT << " poses x " << VIEW_COUNT << " views, "
+            << width << "x" << height << ", baked in " << milliseconds << " ms" << std::endl;
+        return true;
+    }
+
+    bool ready() const { return baked; }
+
+    // Ближайшая снятая поза к фазе цикла ходьбы (радианы)
+    static int poseForPhase(float phase) {
+        int pose = static_cast<int>(std::floor(phase / glm::two_pi<float>() * POSE_COUNT + 0.5f)) % POSE_COUNT;
+        return pose < 0 ? pose + POSE_COUNT : pose;
+    }
+
+    void begin() {
+        mapped = static_cast<Instance*>(instances.beginFrame());
+        count = 0;
+    }
+
+    // position - основание персонажа, yaw в радианах, fade - доля импостера при переходе
+    void add(const glm::vec3& position, float yaw, int pose, float fade) {
+        if (!mapped || count >= maxInstances) return;
+        mapped[count++] = { glm::vec4(position, yaw), glm::vec2(static_cast<float>(pose), fade) };
+    }
+
+    int instanceCount() const { return count; }
+
+    void draw(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos,
+        const glm::vec3& lightPos, const glm::vec3& lightColor) {
+        instances.endWrite();
+        if (count > 0) {
+            shader.use();
+            shader.setMat4("view", view);
+            shader.setMat4("projection", projection);
+            shader.setVec3("viewPos", viewPos);
+            shader.setVec3("lightPos", lightPos);
+            shader.setVec3("lightColor", lightColor);
+            glUniform3f(glGetUniformLocation(shader.ID, "frame"), 2.0f * frameHalfWidth, frameBottom, frameTop - frameBottom);
+
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, textures[0]);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, textures[1]);
+
+            // Область кадра в кольце сдвигается, поэтому указатели атрибутов - каждый кадр
+            glBindVertexArray(VAO);
+            glBindBuffer(GL_ARRAY_BUFFER, instances.ID);
+            const char* base = reinterpret_cast<const char*>(instances.regionOffset());
+            glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), base);
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Instance), base + sizeof(glm::vec4));
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+            glBindVertexArray(0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+        instances.endFrame();
+        mapped = nullptr;
+    }
+
+    // Освобождает GL-ресурсы, пока контекст ещё жив
+    void destroy() {
+        instances.destroy();
+        if (textures[0] != 0) glDeleteTextures(2, textures);
+        if (quadVBO != 0) glDeleteBuffers(1, &quadVBO);
+        if (VAO != 0) glDeleteVertexArrays(1, &VAO);
+        textures[0] = textures[1] = 0;
+        quadVBO = VAO = 0;
+        mapped = nullptr;
+        baked = false;
+    }
+
+private:
+    struct Instance {
+        glm::vec4 positionYaw;
+        glm::vec2 poseFade;
+    };
+
+    Shader shader;
+    StreamBuffer instances;
+    GLuint textures[2] = { 0, 0 };  // цвет с покрытием, нормаль
+    GLuint VAO = 0;
+    GLuint quadVBO = 0;
+    Instance* mapped = nullptr;
+    int count = 0;
+    int maxInstances = 0;
+    float frameHalfWidth = 1.0f;
+    float frameBottom = 0.0f;
+    float frameTop = 1.0f;
+    bool baked = false;
+};
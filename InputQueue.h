@@ -0,0 +1,119 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+// Событие клавиатуры с моментом, когда его получил поток окна (секунды glfwGetTime)
+struct InputEvent {
+    double time;
+    int key;
+    bool pressed;
+};
+
+// Очередь событий без блокировок: один писатель (поток окна, колбэк GLFW) и один
+// читатель (поток кадра). Кольцо фиксированного размера; при переполнении новое
+// событие отбрасывается и учитывается в dropped().
+class InputQueue {
+public:
+    static const uint32_t CAPACITY = 256;   // степень двойки
+
+    InputQueue() = default;
+    InputQueue(const InputQueue&) = delete;
+    InputQueue& operator=(const InputQueue&) = delete;
+
+    // Только поток-писатель
+    bool push(const InputEvent& event) {
+        uint32_t tail = writeIndex.load(std::memory_order_relaxed);
+        if (tail - readIndex.load(std::memory_order_acquire) >= CAPACITY) {
+            droppedCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        events[tail % CAPACITY] = event;
+        writeIndex.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Только поток-читатель: самое старое событие без извлечения
+    bool peek(InputEvent& event) const {
+        uint32_t head = readIndex.load(std::memory_order_relaxed);
+        if (head == writeIndex.load(std::memory_order_acquire)) return false;
+        event = events[head % CAPACITY];
+        return true;
+    }
+
+    void pop() {
+        readIndex.store(readIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    uint32_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+
+private:
+    InputEvent events[CAPACITY];
+    alignas(64) std::atomic<uint32_t> writeIndex{ 0 };
+    alignas(64) std::atomic<uint32_t> readIndex{ 0 };
+    std::atomic<uint32_t> droppedCount{ 0 };
+};
+
+// Состояние клавиш на шаге симуляции [start, end], восстановленное по событиям.
+// Кроме состояния на конец шага известно, сколько секунд клавиша была нажата внутри
+// шага и когда её нажали впервые, поэтому нажатие короче кадра не теряется,
+// а удержание считается с точностью до момента события, а не до длины кадра.
+class InputTimeline {
+public:
+    static const int KEY_COUNT = 349;   // GLFW_KEY_LAST + 1
+
+    void beginStep(double start, double end) {
+        stepStart = start;
+        stepEnd = end;
+        for (int key = 0; key < KEY_COUNT; key++) {
+            held[key] = 0.0f;
+            firstPress[key] = -1.0;
+            downAtStart[key] = down[key];
+            downSince[key] = start;
+        }
+    }
+
+    // События приходят в порядке времени; более ранние, чем начало шага, относятся к его началу
+    void apply(const InputEvent& event) {
+        if (event.key < 0 || event.key >= KEY_COUNT) return;
+        double time = std::min(std::max(event.time, stepStart), stepEnd);
+        int key = event.key;
+        if (event.pressed && !down[key]) {
+            down[key] = true;
+            downSince[key] = time;
+            if (firstPress[key] < 0.0) firstPress[key] = time;
+        }
+        else if (!event.pressed && down[key]) {
+            down[key] = false;
+            held[key] += static_cast<float>(time - downSince[key]);
+        }
+    }
+
+    // Закрывает интервалы клавиш, которые держат до конца шага
+    void endStep() {
+        for (int key = 0; key < KEY_COUNT; key++) {
+            if (down[key]) held[key] += static_cast<float>(stepEnd - downSince[key]);
+        }
+    }
+
+    bool isDown(int key) const { return down[key]; }
+    float heldTime(int key) const { return held[key]; }
+    bool wasActive(int key) const { return down[key] || held[key] > 0.0f || firstPress[key] >= 0.0; }
+
+    // Момент первого нажатия внутри шага; для удерживаемой с прошлого шага - начало шага
+    double activeSince(int key) const {
+        return downAtStart[key] || firstPress[key] < 0.0 ? stepStart : firstPress[key];
+    }
+
+    double start() const { return stepStart; }
+    double end() const { return stepEnd; }
+
+private:
+    bool down[KEY_COUNT] = {};
+    bool downAtStart[KEY_COUNT] = {};
+    float held[KEY_COUNT] = {};
+    double downSince[KEY_COUNT] = {};
+    double firstPress[KEY_COUNT] = {};
+    double stepStart = 0.0;
+    double stepEnd = 0.0;
+};
@@ -0,0 +1,253 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <queue>
+#include <unordered_map>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+// Упрощение треугольной сетки схлопыванием рёбер по квадрикам ошибки (Garland-Heckbert).
+// Вершины с одинаковой позицией сначала свариваются, поэтому плоско затенённые
+// меши (у каждой грани свои вершины) упрощаются так же, как гладкие.
+// Вершина при схлопывании переходит в один из концов ребра; граничные рёбра
+// удерживаются дополнительными перпендикулярными плоскостями.
+// simplify() можно вызывать несколько раз с убывающей целью - упрощение продолжается.
+class MeshSimplifier {
+public:
+    MeshSimplifier(const std::vector<glm::vec3>& sourcePositions, const std::vector<unsigned int>& sourceIndices) {
+        weld(sourcePositions, sourceIndices);
+        buildQuadrics();
+        for (uint32_t v = 0; v < positions.size(); v++) pushEdges(v);
+    }
+
+    size_t triangleCount() const { return liveTriangles; }
+
+    // Геометрическая ошибка (в единицах модели) самого дорогого выполненного схлопывания
+    float error() const { return static_cast<float>(std::sqrt(std::max(0.0, maxError))); }
+
+    void simplify(size_t targetTriangles) {
+        while (liveTriangles > targetTriangles && !heap.empty()) {
+            Candidate candidate = heap.top();
+            heap.pop();
+            if (removed[candidate.from] || removed[candidate.to]) continue;
+            if (version[candidate.from] != candidate.fromVersion || version[candidate.to] != candidate.toVersion) continue;
+            if (flipsTriangle(candidate.from, candidate.to)) continue;
+
+            maxError = std::max(maxError, candidate.cost);
+            collapse(candidate.from, candidate.to);
+        }
+    }
+
+    // Текущая сетка: компактные позиции и индексы живых треугольников
+    void extract(std::vector<glm::vec3>& outPositions, std::vector<unsigned int>& outIndices) const {
+        std::vector<int> remap(positions.size(), -1);
+        outPositions.clear();
+        outIndices.clear();
+        for (size_t t = 0; t < triangleRemoved.size(); t++) {
+            if (triangleRemoved[t]) continue;
+            for (int k = 0; k < 3; k++) {
+                uint32_t v = triangles[t * 3 + k];
+                if (remap[v] < 0) {
+                    remap[v] = static_cast<int>(outPositions.size());
+                    outPositions.push_back(glm::vec3(positions[v]));
+                }
+                outIndices.push_back(static_cast<unsigned int>(remap[v]));
+            }
+        }
+    }
+
+private:
+    // Симметричная матрица 4x4, хранятся 10 коэффициентов
+    struct Quadric {
+        double a[10] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+        void addPlane(double x, double y, double z, double d, double weight = 1.0) {
+            a[0] += weight * x * x; a[1] += weight * x * y; a[2] += weight * x * z; a[3] += weight * x * d;
+            a[4] += weight * y * y; a[5] += weight * y * z; a[6] += weight * y * d;
+            a[7] += weight * z * z; a[8] += weight * z * d;
+            a[9] += weight * d * d;
+        }
+
+        void add(const Quadric& other) {
+            for (int i = 0; i < 10; i++) a[i] += other.a[i];
+        }
+
+        double evaluate(const glm::dvec3& p) const {
+            return a[0] * p.x * p.x + 2 * a[1] * p.x * p.y + 2 * a[2] * p.x * p.z + 2 * a[3] * p.x
+                + a[4] * p.y * p.y + 2 * a[5] * p.y * p.z + 2 * a[6] * p.y
+                + a[7] * p.z * p.z + 2 * a[8] * p.z
+                + a[9];
+        }
+    };
+
+    struct Candidate {
+        double cost;
+        uint32_t from;
+        uint32_t to;
+        uint32_t fromVersion;
+        uint32_t toVersion;
+
+        bool operator<(const Candidate& other) const { return cost > other.cost; } // min-heap
+    };
+
+    std::vector<glm::dvec3> positions;
+    std::vector<uint32_t> triangles;
+    std::vector<bool> triangleRemoved;
+    std::vector<std::vector<uint32_t>> vertexTriangles;
+    std::vector<Quadric> quadrics;
+    std::vector<uint32_t> version;
+    std::vector<bool> removed;
+    std::priority_queue<Candidate> heap;
+    size_t liveTriangles = 0;
+    double maxError = 0.0;
+
+    void weld(const std::vector<glm::vec3>& sourcePositions, const std::vector<unsigned int>& sourceIndices) {
+        struct KeyHash {
+            size_t operator()(const glm::vec3& p) const {
+                uint32_t bits[3];
+                std::memcpy(bits, &p.x, sizeof(float));
+                std::memcpy(bits + 1, &p.y, sizeof(float));
+                std::memcpy(bits + 2, &p.z, sizeof(float));
+                return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+            }
+        };
+        struct KeyEqual {
+            bool operator()(const glm::vec3& a, const glm::vec3& b) const {
+                return a.x == b.x && a.y == b.y && a.z == b.z;
+            }
+        };
+
+        std::unordered_map<glm::vec3, uint32_t, KeyHash, KeyEqual> unique;
+        std::vector<uint32_t> remap(sourcePositions.size());
+        for (size_t i = 0; i < sourcePositions.size(); i++) {
+            auto inserted = unique.emplace(sourcePositions[i], static_cast<uint32_t>(positions.size()));
+            if (inserted.second) positions.push_back(glm::dvec3(sourcePositions[i]));
+            remap[i] = inserted.first->second;
+        }
+
+        vertexTriangles.resize(positions.size());
+        for (size_t i = 0; i + 2 < sourceIndices.size(); i += 3) {
+            uint32_t a = remap[sourceIndices[i]], b = remap[sourceIndices[i + 1]], c = remap[sourceIndices[i + 2]];
+            if (a == b || b == c || a == c) continue;
+            uint32_t t = static_cast<uint32_t>(triangles.size() / 3);
+            triangles.push_back(a);
+            triangles.push_back(b);
+            triangles.push_back(c);
+            vertexTriangles[a].push_back(t);
+            vertexTriangles[b].push_back(t);
+            vertexTriangles[c].push_back(t);
+        }
+        triangleRemoved.assign(triangles.size() / 3, false);
+        liveTriangles = triangleRemoved.size();
+        version.assign(positions.size(), 0);
+        removed.assign(positions.size(), false);
+    }
+
+    glm::dvec3 triangleNormal(uint32_t a, uint32_t b, uint32_t c) const {
+        return glm::cross(positions[b] - positions[a], positions[c] - positions[a]);
+    }
+
+    void buildQuadrics() {
+        quadrics.assign(positions.size(), Quadric());
+        std::unordered_map<uint64_t, int> edgeUse;
+
+        for (size_t t = 0; t < triangleRemoved.size(); t++) {
+            const uint32_t* v = &triangles[t * 3];
+            glm::dvec3 normal = triangleNormal(v[0], v[1], v[2]);
+            double length = glm::length(normal);
+            if (length < 1e-12) continue;
+            normal /= length;
+            double d = -glm::dot(normal, positions[v[0]]);
+            for (int k = 0; k < 3; k++) {
+                quadrics[v[k]].addPlane(normal.x, normal.y, normal.z, d);
+                uint32_t e0 = std::min(v[k], v[(k + 1) % 3]), e1 = std::max(v[k], v[(k + 1) % 3]);
+                edgeUse[(static_cast<uint64_t>(e0) << 32) | e1]++;
+            }
+        }
+
+        // Граница: плоскость через ребро, перпендикулярная грани
+        for (size_t t = 0; t < triangleRemoved.size(); t++) {
+            const uint32_t* v = &triangles[t * 3];
+            glm::dvec3 normal = triangleNormal(v[0], v[1], v[2]);
+            if (glm::length(normal) < 1e-12) continue;
+            normal = glm::normalize(normal);
+            for (int k = 0; k < 3; k++) {
+                uint32_t a = v[k], b = v[(k + 1) % 3];
+                uint64_t key = (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+                if (edgeUse[key] != 1) continue;
+
+                glm::dvec3 edge = positions[b] - positions[a];
+                glm::dvec3 planeNormal = glm::cross(edge, normal);
+                double length = glm::length(planeNormal);
+                if (length < 1e-12) continue;
+                planeNormal /= length;
+                double d = -glm::dot(planeNormal, positions[a]);
+                quadrics[a].addPlane(planeNormal.x, planeNormal.y, planeNormal.z, d, 10.0);
+                quadrics[b].addPlane(planeNormal.x, planeNormal.y, planeNormal.z, d, 10.0);
+            }
+        }
+    }
+
+    // Кандидаты на схлопывание всех рёбер, выходящих из вершины
+    void pushEdges(uint32_t v) {
+        for (uint32_t t : vertexTriangles[v]) {
+            if (triangleRemoved[t]) continue;
+            for (int k = 0; k < 3; k++) {
+                uint32_t other = triangles[t * 3 + k];
+                if (other == v) continue;
+
+                Quadric sum = quadrics[v];
+                sum.add(quadrics[other]);
+                double costToOther = sum.evaluate(positions[other]);
+                double costToV = sum.evaluate(positions[v]);
+                if (costToOther <= costToV) heap.push({ costToOther, v, other, version[v], version[other] });
+                else heap.push({ costToV, other, v, version[other], version[v] });
+            }
+        }
+    }
+
+    // Запрет схлопываний, разворачивающих соседние треугольники
+    bool flipsTriangle(uint32_t from, uint32_t to) const {
+        for (uint32_t t : vertexTriangles[from]) {
+            if (triangleRemoved[t]) continue;
+            const uint32_t* v = &triangles[t * 3];
+            if (v[0] == to || v[1] == to || v[2] == to) continue;
+
+            uint32_t moved[3] = { v[0], v[1], v[2] };
+            for (int k = 0; k < 3; k++) if (moved[k] == from) moved[k] = to;
+
+            glm::dvec3 before = triangleNormal(v[0], v[1], v[2]);
+            glm::dvec3 after = triangleNormal(moved[0], moved[1], moved[2]);
+            double beforeLength = glm::length(before), afterLength = glm::length(after);
+            if (afterLength < 1e-12) return true;
+            if (beforeLength > 1e-12 && glm::dot(before, after) < 0.2 * beforeLength * afterLength) return true;
+        }
+        return false;
+    }
+
+    void collapse(uint32_t from, uint32_t to) {
+        for (uint32_t t : vertexTriangles[from]) {
+            if (triangleRemoved[t]) continue;
+            uint32_t* v = &triangles[t * 3];
+            if (v[0] == to || v[1] == to || v[2] == to) {
+                triangleRemoved[t] = true;
+                liveTriangles--;
+                continue;
+            }
+            for (int k = 0; k < 3; k++) if (v[k] == from) v[k] = to;
+            vertexTriangles[to].push_back(t);
+        }
+
+        // Убрать ссылки на удалённые треугольники, чтобы списки смежности не разрастались
+        auto& list = vertexTriangles[to];
+        list.erase(std::remove_if(list.begin(), list.end(), [this](uint32_t t) { return triangleRemoved[t]; }), list.end());
+
+        quadrics[to].add(quadrics[from]);
+        removed[from] = true;
+        vertexTriangles[from].clear();
+        version[to]++;
+        pushEdges(to);
+    }
+};
@@ -0,0 +1,343 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <charconv>
+#include <unordered_map>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include "MappedFile.h"
+
+// Один объект (o) или группа (g) из OBJ-файла после дедупликации вершин
+struct ObjObject {
+    std::string name;
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<unsigned int> indices;
+    std::vector<unsigned int> sourcePositions;  // индекс v в файле для каждой вершины: связность до дедупликации
+};
+
+// Потоковый читатель OBJ.
+// Файл отображается в память и читается за один проход; большие файлы делятся
+// по границам строк между потоками, затем части склеиваются.
+// Вершины с одинаковой парой индексов (v, vn) объединяются. Если у грани нет vn,
+// берётся нормаль грани (плоское затенение, как aiProcess_GenNormals).
+class ObjReader {
+public:
+    size_t parallelThreshold = 1 << 20;     // файлы меньше этого размера читаются в одном потоке
+    size_t minBytesPerThread = 256 << 10;
+
+    bool read(const std::string& path, std::vector<ObjObject>& objects) {
+        objects.clear();
+        errorMessage.clear();
+        filePath = path;
+
+        MappedFile file;
+        if (!file.open(path)) {
+            errorMessage = path + ": cannot open file";
+            return false;
+        }
+
+        const char* begin = reinterpret_cast<const char*>(file.data());
+        const char* end = begin + file.size();
+
+        // Разбиение на части по границам строк
+        size_t threadCount = 1;
+        if (file.size() >= parallelThreshold) {
+            size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+            threadCount = std::min(hardware, std::max<size_t>(1, file.size() / minBytesPerThread));
+        }
+        std::vector<const char*> bounds{ begin };
+        for (size_t i = 1; i < threadCount; i++) {
+            const char* split = begin + file.size() * i / threadCount;
+            split = std::max(split, bounds.back());
+            const char* newline = static_cast<const char*>(std::memchr(split, '\n', end - split));
+            bounds.push_back(newline ? newline + 1 : end);
+        }
+        bounds.push_back(end);
+        threadsUsed = bounds.size() - 1;
+
+        std::vector<Chunk> chunks(threadsUsed);
+        if (threadsUsed == 1) {
+            parseChunk(bounds[0], bounds[1], chunks[0]);
+        }
+        else {
+            std::vector<std::thread> workers;
+            for (size_t i = 0; i < threadsUsed; i++) {
+                workers.emplace_back(&ObjReader::parseChunk, this, bounds[i], bounds[i + 1], std::ref(chunks[i]));
+            }
+            for (auto& worker : workers) worker.join();
+        }
+
+        return merge(chunks, objects);
+    }
+
+    const std::string& error() const { return errorMessage; }
+    size_t threadCount() const { return threadsUsed; }
+
+private:
+    // Индекс в OBJ: абсолютный (1-based) или относительный (отрицательный)
+    struct Corner {
+        int32_t position;
+        int32_t normal;         // -1 - нет нормали
+        bool relativePosition;
+        bool relativeNormal;
+    };
+
+    struct GroupMark {
+        std::string name;
+        size_t firstCorner;
+    };
+
+    struct Chunk {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> normals;
+        std::vector<Corner> corners;            // по три на треугольник
+        std::vector<uint32_t> triangleLines;    // номер строки внутри части
+        std::vector<GroupMark> groups;
+        uint32_t lineCount = 0;
+        uint32_t errorLine = 0;
+        std::string error;
+    };
+
+    std::string errorMessage;
+    std::string filePath;
+    size_t threadsUsed = 1;
+
+    static const char* skipSpaces(const char* p, const char* end) {
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+        return p;
+    }
+
+    static const char* parseFloat(const char* p, const char* end, float& value) {
+        p = skipSpaces(p, end);
+        if (p < end && *p == '+') p++;
+        auto result = std::from_chars(p, end, value);
+        return result.ec == std::errc() ? result.ptr : nullptr;
+    }
+
+    static const char* parseInt(const char* p, const char* end, int32_t& value) {
+        auto result = std::from_chars(p, end, value);
+        return result.ec == std::errc() ? result.ptr : nullptr;
+    }
+
+    static bool parseVec3(const char* p, const char* end, glm::vec3& value) {
+        for (int i = 0; i < 3; i++) {
+            p = parseFloat(p, end, value[i]);
+            if (!p) return false;
+        }
+        return true;
+    }
+
+    // v, v/vt, v//vn, v/vt/vn
+    static const char* parseCorner(const char* p, const char* end, Corner& corner) {
+        int32_t value = 0;
+        p = parseInt(p, end, value);
+        if (!p || value == 0) return nullptr;
+        corner.relativePosition = value < 0;
+        corner.position = value < 0 ? value : value - 1;
+        corner.normal = -1;
+        corner.relativeNormal = false;
+
+        if (p < end && *p == '/') {
+            p++;
+            if (p < end && *p != '/') {
+                int32_t texcoord = 0;
+                p = parseInt(p, end, texcoord); // текстурные координаты не используются
+                if (!p) return nullptr;
+            }
+            if (p < end && *p == '/') {
+                p++;
+                p = parseInt(p, end, value);
+                if (!p || value == 0) return nullptr;
+                corner.relativeNormal = value < 0;
+                corner.normal = value < 0 ? value : value - 1;
+            }
+        }
+        return p;
+    }
+
+    void parseChunk(const char* p, const char* end, Chunk& chunk) {
+        Corner polygon[64];
+
+        while (p < end) {
+            const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            if (!lineEnd) lineEnd = end;
+            const char* next = lineEnd < end ? lineEnd + 1 : end;
+            if (lineEnd > p && lineEnd[-1] == '\r') lineEnd--;
+            chunk.lineCount++;
+
+            const char* line = skipSpaces(p, lineEnd);
+            p = next;
+            if (line >= lineEnd || *line == '#') continue;
+
+            auto fail = [&](const char* message) {
+                chunk.error = message;
+                chunk.errorLine = chunk.lineCount;
+            };
+
+            if (line[0] == 'v' && lineEnd - line > 1 && (line[1] == ' ' || line[1] == '\t')) {
+                glm::vec3 position;
+                if (!parseVec3(line + 1, lineEnd, position)) return fail("malformed vertex position");
+                chunk.positions.push_back(position);
+            }
+            else if (line[0] == 'v' && lineEnd - line > 2 && line[1] == 'n' && (line[2] == ' ' || line[2] == '\t')) {
+                glm::vec3 normal;
+                if (!parseVec3(line + 2, lineEnd, normal)) return fail("malformed vertex normal");
+                chunk.normals.push_back(normal);
+            }
+            else if (line[0] == 'f' && lineEnd - line > 1 && (line[1] == ' ' || line[1] == '\t')) {
+                int count = 0;
+                const char* q = skipSpaces(line + 1, lineEnd);
+                while (q < lineEnd) {
+                    if (count == 64) return fail("face has more than 64 vertices");
+                    q = parseCorner(q, lineEnd, polygon[count]);
+                    if (!q) return fail("malformed face index");
+                    // Относительный индекс считаем от локального числа вершин части
+                    if (polygon[count].relativePosition) polygon[count].position += static_cast<int32_t>(chunk.positions.size());
+                    if (polygon[count].relativeNormal) polygon[count].normal += static_cast<int32_t>(chunk.normals.size());
+                    count++;
+                    q = skipSpaces(q, lineEnd);
+                }
+                if (count < 3) return fail("face has fewer than 3 vertices");
+
+                for (int i = 1; i + 1 < count; i++) {
+                    chunk.corners.push_back(polygon[0]);
+                    chunk.corners.push_back(polygon[i]);
+                    chunk.corners.push_back(polygon[i + 1]);
+                    chunk.triangleLines.push_back(chunk.lineCount);
+                }
+            }
+            else if ((line[0] == 'o' || line[0] == 'g') && (lineEnd - line == 1 || line[1] == ' ' || line[1] == '\t')) {
+                const char* name = skipSpaces(line + 1, lineEnd);
+                const char* nameEnd = lineEnd;
+                while (nameEnd > name && (nameEnd[-1] == ' ' || nameEnd[-1] == '\t')) nameEnd--;
+                chunk.groups.push_back({ std::string(name, nameEnd), chunk.corners.size() });
+            }
+            // vt, s, usemtl, mtllib и прочее не нужны для геометрии
+        }
+    }
+
+    bool merge(std::vector<Chunk>& chunks, std::vector<ObjObject>& objects) {
+        size_t positionCount = 0, normalCount = 0;
+        uint32_t firstLine = 0;
+        for (auto& chunk : chunks) {
+            if (!chunk.error.empty()) {
+                errorMessage = filePath + ":" + std::to_string(firstLine + chunk.errorLine) + ": " + chunk.error;
+                return false;
+            }
+            firstLine += chunk.lineCount;
+            positionCount += chunk.positions.size();
+            normalCount += chunk.normals.size();
+        }
+
+        std::vector<glm::vec3> positions, normals;
+        positions.reserve(positionCount);
+        normals.reserve(normalCount);
+
+        // Диапазоны углов по объектам; одноимённые группы сливаются
+        struct Range { size_t object; size_t chunk; size_t first; size_t last; };
+        std::vector<Range> ranges;
+        std::unordered_map<std::string, size_t> objectIndex;
+        std::string currentName = "default";
+
+        auto objectFor = [&](const std::string& name) {
+            auto found = objectIndex.find(name);
+            if (found != objectIndex.end()) return found->second;
+            objectIndex[name] = objects.size();
+            objects.push_back(ObjObject());
+            objects.back().name = name;
+            return objects.size() - 1;
+        };
+
+        for (size_t c = 0; c < chunks.size(); c++) {
+            Chunk& chunk = chunks[c];
+            int32_t positionBase = static_cast<int32_t>(positions.size());
+            int32_t normalBase = static_cast<int32_t>(normals.size());
+
+            for (auto& corner : chunk.corners) {
+                if (corner.relativePosition) corner.position += positionBase;
+                if (corner.relativeNormal) corner.normal += normalBase;
+            }
+            positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+            normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+
+            size_t start = 0;
+            for (const auto& group : chunk.groups) {
+                if (group.firstCorner > start) ranges.push_back({ objectFor(currentName), c, start, group.firstCorner });
+                start = group.firstCorner;
+                currentName = group.name.empty() ? "default" : group.name;
+            }
+            if (chunk.corners.size() > start) ranges.push_back({ objectFor(currentName), c, start, chunk.corners.size() });
+        }
+
+        // Построение вершин объектов с дедупликацией по (v, vn)
+        std::vector<std::unordered_map<uint64_t, unsigned int>> vertexMaps(objects.size());
+        firstLine = 0;
+        std::vector<uint32_t> chunkFirstLine(chunks.size());
+        for (size_t c = 0; c < chunks.size(); c++) {
+            chunkFirstLine[c] = firstLine;
+            firstLine += chunks[c].lineCount;
+        }
+
+        for (const auto& range : ranges) {
+            ObjObject& object = objects[range.object];
+            auto& vertexMap = vertexMaps[range.object];
+            const Chunk& chunk = chunks[range.chunk];
+
+            for (size_t i = range.first; i < range.last; i += 3) {
+                const Corner* triangle = &chunk.corners[i];
+                for (int k = 0; k < 3; k++) {
+                    if (triangle[k].position < 0 || static_cast<size_t>(triangle[k].position) >= positions.size() ||
+                        static_cast<size_t>(triangle[k].normal + 1) > normals.size()) {
+                        errorMessage = filePath + ":" + std::to_string(chunkFirstLine[range.chunk] + chunk.triangleLines[i / 3]) +
+                            ": face index out of range";
+                        objects.clear();
+                        return false;
+                    }
+                }
+
+                glm::vec3 faceNormal(0.0f, 1.0f, 0.0f);
+                bool needsFaceNormal = triangle[0].normal < 0 || triangle[1].normal < 0 || triangle[2].normal < 0;
+                if (needsFaceNormal) {
+                    glm::vec3 cross = glm::cross(positions[triangle[1].position] - positions[triangle[0].position],
+                        positions[triangle[2].position] - positions[triangle[0].position]);
+                    if (glm::length(cross) > 1e-12f) faceNormal = glm::normalize(cross);
+                }
+
+                for (int k = 0; k < 3; k++) {
+                    const Corner& corner = triangle[k];
+                    if (corner.normal < 0) {
+                        // Плоская нормаль уникальна для грани - такую вершину не с кем объединять
+                        object.indices.push_back(static_cast<unsigned int>(object.positions.size()));
+                        object.positions.push_back(positions[corner.position]);
+                        object.normals.push_back(faceNormal);
+                        object.sourcePositions.push_back(static_cast<unsigned int>(corner.position));
+                        continue;
+                    }
+
+                    uint64_t key = (static_cast<uint64_t>(corner.position) << 32) | static_cast<uint32_t>(corner.normal);
+                    auto found = vertexMap.find(key);
+                    if (found != vertexMap.end()) {
+                        object.indices.push_back(found->second);
+                        continue;
+                    }
+                    unsigned int index = static_cast<unsigned int>(object.positions.size());
+                    vertexMap.emplace(key, index);
+                    object.indices.push_back(index);
+                    object.positions.push_back(positions[corner.position]);
+                    object.normals.push_back(normals[corner.normal]);
+                    object.sourcePositions.push_back(static_cast<unsigned int>(corner.position));
+                }
+            }
+        }
+
+        if (objects.empty()) {
+            errorMessage = filePath + ": no faces found";
+            return false;
+        }
+        return true;
+    }
+};
@@ -0,0 +1,217 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <unordered_map>
+#include "MappedFile.h"
+
+// Тип препятствия вместо строки с именем
+enum class ObstacleType : uint32_t {
+    Box = 0,
+    Wall = 1,
+    Arch = 2,
+    Stairs = 3,
+    Count
+};
+
+// Бинарный формат сцены (.scn), little-endian:
+//   SceneHeader
+//   SceneMeshEntry[meshCount]         - таблица мешей, на неё ссылаются препятствия
+//   SceneObstacleRecord[obstacleCount] - таблица препятствий фиксированного размера
+// Файл отображается в память и читается без разбора, таблицы используются как есть.
+const uint32_t SCENE_MAGIC = 0x424E4353; // "SCNB"
+const uint32_t SCENE_VERSION = 1;
+const char* const SCENE_CUBE_MESH = "cube";
+
+struct SceneHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t meshCount;
+    uint32_t obstacleCount;
+    uint64_t meshTableOffset;
+    uint64_t obstacleTableOffset;
+};
+
+struct SceneMeshEntry {
+    char path[64];          // "cube" или путь к .obj, с завершающим нулём
+};
+
+struct SceneObstacleRecord {
+    uint32_t mesh;          // индекс в таблице мешей
+    uint32_t type;          // ObstacleType
+    float position[3];
+    float scale[3];
+    float color[3];
+    float boundsMin[3];     // относительно position
+    float boundsMax[3];
+};
+
+static_assert(sizeof(SceneHeader) == 32, "SceneHeader layout must not change");
+static_assert(sizeof(SceneObstacleRecord) == 68, "SceneObstacleRecord layout must not change");
+
+// Сцена, открытая через отображение файла; таблицы указывают прямо в отображённую память
+class SceneFile {
+public:
+    bool open(const std::string& path) {
+        if (!file.open(path)) {
+            std::cerr << "ERROR::SCENE::CANNOT_OPEN: " << path << std::endl;
+            return false;
+        }
+        if (file.size() < sizeof(SceneHeader)) {
+            return fail(path, "file is smaller than the header");
+        }
+
+        header = reinterpret_cast<const SceneHeader*>(file.data());
+        if (header->magic != SCENE_MAGIC) return fail(path, "bad magic");
+        if (header->version != SCENE_VERSION) return fail(path, "unsupported version");
+        if (!tableFits(header->meshTableOffset, header->meshCount, sizeof(SceneMeshEntry))) {
+            return fail(path, "mesh table out of bounds");
+        }
+        if (!tableFits(header->obstacleTableOffset, header->obstacleCount, sizeof(SceneObstacleRecord))) {
+            return fail(path, "obstacle table out of bounds");
+        }
+        if (header->obstacleTableOffset % alignof(SceneObstacleRecord) != 0) {
+            return fail(path, "obstacle table is misaligned");
+        }
+
+        for (uint32_t i = 0; i < header->obstacleCount; i++) {
+            const SceneObstacleRecord& record = obstacles()[i];
+            if (record.mesh >= header->meshCount || record.type >= static_cast<uint32_t>(ObstacleType::Count)) {
+                return fail(path, "obstacle " + std::to_string(i) + " references an unknown mesh or type");
+            }
+        }
+        for (uint32_t i = 0; i < header->meshCount; i++) {
+            if (std::memchr(meshes()[i].path, 0, sizeof(SceneMeshEntry::path)) == nullptr) {
+                return fail(path, "mesh " + std::to_string(i) + " path is not terminated");
+            }
+        }
+        return true;
+    }
+
+    uint32_t meshCount() const { return header ? header->meshCount : 0; }
+    uint32_t obstacleCount() const { return header ? header->obstacleCount : 0; }
+
+    const SceneMeshEntry* meshes() const {
+        return reinterpret_cast<const SceneMeshEntry*>(file.data() + header->meshTableOffset);
+    }
+
+    const SceneObstacleRecord* obstacles() const {
+        return reinterpret_cast<const SceneObstacleRecord*>(file.data() + header->obstacleTableOffset);
+    }
+
+private:
+    MappedFile file;
+    const SceneHeader* header = nullptr;
+
+    bool tableFits(uint64_t offset, uint32_t count, size_t stride) const {
+        return offset <= file.size() && static_cast<uint64_t>(count) * stride <= file.size() - offset;
+    }
+
+    bool fail(const std::string& path, const std::string& reason) {
+        std::cerr << "ERROR::SCENE::INVALID_FILE: " << path << ": " << reason << std::endl;
+        header = nullptr;
+        file.close();
+        return false;
+    }
+};
+
+// Конвертер текстового описания сцены в .scn.
+// Формат строк (# - комментарий):
+//   mesh <cube|path.obj>
+//   obstacle <box|wall|arch|stairs> <meshIndex> px py pz sx sy sz r g b [minx miny minz maxx maxy maxz]
+// Без явных границ берётся AABB масштабированного единичного куба.
+inline bool convertSceneText(const std::string& textPath, const std::string& binaryPath) {
+    std::ifstream input(textPath);
+    if (!input) {
+        std::cerr << "ERROR::SCENE::CANNOT_OPEN: " << textPath << std::endl;
+        return false;
+    }
+
+    static const std::unordered_map<std::string, ObstacleType> typeNames = {
+        { "box", ObstacleType::Box }, { "wall", ObstacleType::Wall },
+        { "arch", ObstacleType::Arch }, { "stairs", ObstacleType::Stairs }
+    };
+
+    std::vector<SceneMeshEntry> meshes;
+    std::vector<SceneObstacleRecord> obstacles;
+    std::string line;
+    int lineNumber = 0;
+
+    auto error = [&](const std::string& message) {
+        std::cerr << textPath << ":" << lineNumber << ": " << message << std::endl;
+        return false;
+    };
+
+    while (std::getline(input, line)) {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        std::istringstream fields(line);
+        std::string keyword;
+        if (!(fields >> keyword) || keyword[0] == '#') continue;
+
+        if (keyword == "mesh") {
+            std::string path;
+            if (!(fields >> path)) return error("mesh needs a path or 'cube'");
+            if (path.size() >= sizeof(SceneMeshEntry::path)) return error("mesh path is too long");
+            SceneMeshEntry entry{};
+            std::memcpy(entry.path, path.c_str(), path.size());
+            meshes.push_back(entry);
+        }
+        else if (keyword == "obstacle") {
+            std::string typeName;
+            SceneObstacleRecord record{};
+            fields >> typeName >> record.mesh
+                >> record.position[0] >> record.position[1] >> record.position[2]
+                >> record.scale[0] >> record.scale[1] >> record.scale[2]
+                >> record.color[0] >> record.color[1] >> record.color[2];
+            if (!fields) return error("obstacle needs type, mesh, position, scale and color");
+
+            auto type = typeNames.find(typeName);
+            if (type == typeNames.end()) return error("unknown obstacle type '" + typeName + "'");
+            if (record.mesh >= meshes.size()) return error("mesh index is not declared yet");
+            record.type = static_cast<uint32_t>(type->second);
+
+            if (fields >> record.boundsMin[0]) {
+                fields >> record.boundsMin[1] >> record.boundsMin[2]
+                    >> record.boundsMax[0] >> record.boundsMax[1] >> record.boundsMax[2];
+                if (!fields) return error("bounds need six numbers");
+            }
+            else {
+                for (int axis = 0; axis < 3; axis++) {
+                    record.boundsMin[axis] = -0.5f * record.scale[axis];
+                    record.boundsMax[axis] = 0.5f * record.scale[axis];
+                }
+            }
+            obstacles.push_back(record);
+        }
+        else {
+            return error("unknown keyword '" + keyword + "'");
+        }
+    }
+
+    SceneHeader header{};
+    header.magic = SCENE_MAGIC;
+    header.version = SCENE_VERSION;
+    header.meshCount = static_cast<uint32_t>(meshes.size());
+    header.obstacleCount = static_cast<uint32_t>(obstacles.size());
+    header.meshTableOffset = sizeof(SceneHeader);
+    header.obstacleTableOffset = header.meshTableOffset + meshes.size() * sizeof(SceneMeshEntry);
+
+    std::ofstream output(binaryPath, std::ios::binary | std::ios::trunc);
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    output.write(reinterpret_cast<const char*>(meshes.data()), meshes.size() * sizeof(SceneMeshEntry));
+    output.write(reinterpret_cast<const char*>(obstacles.data()), obstacles.size() * sizeof(SceneObstacleRecord));
+    if (!output) {
+        std::cerr << "ERROR::SCENE::CANNOT_WRITE: " << binaryPath << std::endl;
+        return false;
+    }
+
+    std::cout << "Scene " << textPath << " -> " << binaryPath << ": "
+        << meshes.size() << " meshes, " << obstacles.size() << " obstacles" << std::endl;
+    return true;
+}
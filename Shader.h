@@ -1,47 +1,356 @@
 #pragma once
 #include <glad/glad.h>
 #include <string>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
 #include <glm/glm.hpp>
 
+// ARB_get_program_binary tokens (glad may be generated for plain 3.3 core)
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+// Shader class
+// Программа собирается из исходников или берётся из кэша бинарников на диске.
+// Ключ кэша - хэш исходников, define-ов и строк vendor/renderer/version драйвера,
+// поэтому обновление драйвера или правка шейдера просто даёт промах кэша.
 class Shader {
 public:
-    unsigned int ID;
+    typedef void* (*LoadProc)(const char* name);
+
+    unsigned int ID = 0;
+
+    Shader() = default;
+
+    Shader(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines = {}) {
+        load(vertexPath, fragmentPath, defines);
+    }
+
+    // Включает кэш бинарников программ; вызывать после создания GL-контекста
+    static void enableBinaryCache(const std::string& directory, LoadProc loader) {
+        BinaryCache& cache = binaryCache();
+        cache.enabled = false;
+
+        GLint formatCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+        if (formatCount <= 0 || !loader) {
+            std::cout << "Program binary cache unavailable: driver reports no binary formats" << std::endl;
+            return;
+        }
+
+        cache.getProgramBinary = reinterpret_cast<GetProgramBinaryProc>(loader("glGetProgramBinary"));
+        cache.programBinary = reinterpret_cast<ProgramBinaryProc>(loader("glProgramBinary"));
+        cache.programParameteri = reinterpret_cast<ProgramParameteriProc>(loader("glProgramParameteri"));
+        if (!cache.getProgramBinary || !cache.programBinary || !cache.programParameteri) {
+            std::cout << "Program binary cache unavailable: entry points not found" << std::endl;
+            return;
+        }
+
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        if (error) {
+            std::cerr << "ERROR::SHADER::CACHE_DIRECTORY: " << directory << ": " << error.message() << std::endl;
+            return;
+        }
+
+        cache.directory = directory;
+        cache.driverKey = glString(GL_VENDOR) + "|" + glString(GL_RENDERER) + "|" + glString(GL_VERSION);
+        cache.enabled = true;
+    }
+
+    bool load(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines = {}) {
+        auto startTime = std::chrono::steady_clock::now();
 
-    Shader(const char* vertexPath, const char* fragmentPath) {
         std::string vertexCode, fragmentCode;
-        std::ifstream vShaderFile(vertexPath), fShaderFile(fragmentPath);
-        std::stringstream vShaderStream, fShaderStream;
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
+        std::ifstream vShaderFile, fShaderFile;
+
+        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+        try {
+            vShaderFile.open(vertexPath);
+            fShaderFile.open(fragmentPath);
+
+            std::stringstream vShaderStream, fShaderStream;
+            vShaderStream << vShaderFile.rdbuf();
+            fShaderStream << fShaderFile.rdbuf();
+
+            vShaderFile.close();
+            fShaderFile.close();
+
+            vertexCode = injectDefines(vShaderStream.str(), defines);
+            fragmentCode = injectDefines(fShaderStream.str(), defines);
+        }
+        catch (std::ifstream::failure& e) {
+            std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+            return false;
+        }
 
+        std::string cachePath;
+        if (binaryCache().enabled) {
+            cachePath = cacheFilePath(vertexCode, fragmentCode, defines);
+            if (loadBinary(cachePath)) {
+                logStartup(vertexPath, fragmentPath, startTime, "binary cache hit");
+                return true;
+            }
+        }
+
+        if (!compile(vertexCode, fragmentCode)) return false;
+
+        if (!cachePath.empty()) saveBinary(cachePath);
+        logStartup(vertexPath, fragmentPath, startTime, cachePath.empty() ? "compiled" : "compiled, cached");
+        return true;
+    }
+
+    void use() {
+        if (ID != 0) glUseProgram(ID);
+    }
+
+    void setMat4(const std::string& name, const glm::mat4& mat) const {
+        if (ID != 0) {
+            glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        }
+    }
+
+    void setVec3(const std::string& name, const glm::vec3& value) const {
+        if (ID != 0) {
+            glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        }
+    }
+
+    void setFloat(const std::string& name, float value) const {
+        if (ID != 0) {
+            glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        }
+    }
+
+    void setInt(const std::string& name, int value) const {
+        if (ID != 0) {
+            glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        }
+    }
+
+    void bindUniformBlock(const std::string& name, unsigned int binding) const {
+        if (ID == 0) return;
+        unsigned int index = glGetUniformBlockIndex(ID, name.c_str());
+        if (index != GL_INVALID_INDEX) glUniformBlockBinding(ID, index, binding);
+    }
+
+private:
+    typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+    typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+    typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+
+    struct BinaryCache {
+        bool enabled = false;
+        std::string directory;
+        std::string driverKey;
+        GetProgramBinaryProc getProgramBinary = nullptr;
+        ProgramBinaryProc programBinary = nullptr;
+        ProgramParameteriProc programParameteri = nullptr;
+    };
+
+    // Заголовок файла кэша: magic, формат бинарника и длина данных
+    struct CacheHeader {
+        uint32_t magic;
+        uint32_t format;
+        uint32_t length;
+    };
+    static const uint32_t CACHE_MAGIC = 0x53484250; // "SHBP"
+
+    static BinaryCache& binaryCache() {
+        static BinaryCache cache;
+        return cache;
+    }
+
+    static std::string glString(GLenum name) {
+        const GLubyte* value = glGetString(name);
+        return value ? reinterpret_cast<const char*>(value) : "";
+    }
+
+    // FNV-1a, 64 бита
+    static uint64_t hashString(const std::string& text, uint64_t hash = 14695981039346656037ull) {
+        for (unsigned char c : text) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // Вставляет #define сразу после строки #version
+    static std::string injectDefines(const std::string& source, const std::vector<std::string>& defines) {
+        if (defines.empty()) return source;
+
+        std::string block;
+        for (const auto& define : defines) block += "#define " + define + "\n";
+
+        size_t insertAt = 0;
+        if (source.compare(0, 8, "#version") == 0) {
+            size_t lineEnd = source.find('\n');
+            insertAt = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+        }
+        std::string result = source;
+        result.insert(insertAt, block);
+        return result;
+    }
+
+    static std::string cacheFilePath(const std::string& vertexCode, const std::string& fragmentCode,
+        const std::vector<std::string>& defines) {
+        uint64_t hash = hashString(binaryCache().driverKey);
+        hash = hashString(vertexCode, hash);
+        hash = hashString("\x1f", hash);
+        hash = hashString(fragmentCode, hash);
+        for (const auto& define : defines) hash = hashString("\x1f" + define, hash);
+
+        std::ostringstream name;
+        name << binaryCache().directory << "/" << std::hex << std::setw(16) << std::setfill('0') << hash << ".bin";
+        return name.str();
+    }
+
+    bool compile(const std::string& vertexCode, const std::string& fragmentCode) {
         const char* vShaderCode = vertexCode.c_str();
         const char* fShaderCode = fragmentCode.c_str();
 
-        unsigned int vertex = glCreateShader(GL_VERTEX_SHADER);
+        unsigned int vertex, fragment;
+
+        vertex = glCreateShader(GL_VERTEX_SHADER);
         glShaderSource(vertex, 1, &vShaderCode, NULL);
         glCompileShader(vertex);
+        if (!checkCompileErrors(vertex, "VERTEX")) {
+            glDeleteShader(vertex);
+            return false;
+        }
 
-        unsigned int fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        fragment = glCreateShader(GL_FRAGMENT_SHADER);
         glShaderSource(fragment, 1, &fShaderCode, NULL);
         glCompileShader(fragment);
+        if (!checkCompileErrors(fragment, "FRAGMENT")) {
+            glDeleteShader(vertex);
+            glDeleteShader(fragment);
+            return false;
+        }
 
         ID = glCreateProgram();
+        if (binaryCache().enabled) {
+            binaryCache().programParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
         glAttachShader(ID, vertex);
         glAttachShader(ID, fragment);
         glLinkProgram(ID);
+        if (!checkCompileErrors(ID, "PROGRAM")) {
+            glDeleteShader(vertex);
+            glDeleteShader(fragment);
+            glDeleteProgram(ID);
+            ID = 0;
+            return false;
+        }
 
         glDeleteShader(vertex);
         glDeleteShader(fragment);
+        return true;
     }
 
-    void use() { glUseProgram(ID); }
+    // Драйвер вправе отклонить бинарник (другая версия, другая сборка) - тогда компилируем заново
+    bool loadBinary(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return false;
 
-    void setMat4(const std::string& name, const glm::mat4& mat) const {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        CacheHeader header{};
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!file || header.magic != CACHE_MAGIC || header.length == 0) return false;
+
+        std::vector<char> binary(header.length);
+        file.read(binary.data(), header.length);
+        if (!file) return false;
+
+        unsigned int program = glCreateProgram();
+        binaryCache().programBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+
+        int success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            std::cout << "Program binary rejected by driver, recompiling: " << path << std::endl;
+            glDeleteProgram(program);
+            return false;
+        }
+
+        ID = program;
+        return true;
+    }
+
+    void saveBinary(const std::string& path) const {
+        GLint length = 0;
+        glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) return;
+
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        GLsizei written = 0;
+        binaryCache().getProgramBinary(ID, length, &written, &format, binary.data());
+        if (written <= 0) return;
+
+        // Пишем во временный файл и переименовываем, чтобы не оставить обрезанную запись
+        std::string tempPath = path + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            CacheHeader header{ CACHE_MAGIC, static_cast<uint32_t>(format), static_cast<uint32_t>(written) };
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(binary.data(), written);
+            if (!file) {
+                std::cerr << "ERROR::SHADER::CACHE_WRITE_FAILED: " << tempPath << std::endl;
+                return;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tempPath, path, error);
+        if (error) {
+            std::cerr << "ERROR::SHADER::CACHE_WRITE_FAILED: " << path << ": " << error.message() << std::endl;
+            std::filesystem::remove(tempPath, error);
+        }
+    }
+
+    static void logStartup(const char* vertexPath, const char* fragmentPath,
+        std::chrono::steady_clock::time_point startTime, const char* source) {
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+        // Формат только для этой строки: std::cout остаётся с настройками по умолчанию
+        std::ostringstream line;
+        line << "Shader " << vertexPath << " + " << fragmentPath << ": "
+            << std::fixed << std::setprecision(2) << ms << " ms (" << source << ")";
+        std::cout << line.str() << std::endl;
+    }
+
+    bool checkCompileErrors(unsigned int shader, std::string type) {
+        int success;
+        char infoLog[1024];
+        if (type != "PROGRAM") {
+            glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+            if (!success) {
+                glGetShaderInfoLog(shader, 1024, NULL, infoLog);
+                std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n";
+                return false;
+            }
+        }
+        else {
+            glGetProgramiv(shader, GL_LINK_STATUS, &success);
+            if (!success) {
+                glGetProgramInfoLog(shader, 1024, NULL, infoLog);
+                std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n";
+                return false;
+            }
+        }
+        return true;
     }
 };
@@ -0,0 +1,183 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstring>
+#include <iostream>
+
+// ARB_buffer_storage tokens (glad may be generated for plain 3.3 core)
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+// Кольцевой буфер для потоковых данных кадра.
+// Буфер делится на regionCount областей (по умолчанию три): CPU пишет в одну,
+// пока GPU читает предыдущие. Каждая область защищена fence-синхронизацией.
+// При наличии glBufferStorage буфер отображается один раз (persistent + coherent),
+// иначе используется orphaning через glBufferData и glMapBufferRange.
+class StreamBuffer {
+public:
+    typedef void* (*LoadProc)(const char* name);
+
+    unsigned int ID = 0;
+
+    StreamBuffer() = default;
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    ~StreamBuffer() {
+        destroy();
+    }
+
+    bool create(GLenum bufferTarget, GLsizeiptr size, GLsizeiptr alignment, LoadProc loader, int count = 3) {
+        destroy();
+
+        target = bufferTarget;
+        regionCount = count;
+        regionBytes = alignment > 1 ? (size + alignment - 1) / alignment * alignment : size;
+        totalBytes = regionBytes * regionCount;
+        current = 0;
+        for (int i = 0; i < MAX_REGIONS; i++) fences[i] = 0;
+        if (regionCount < 1 || regionCount > MAX_REGIONS) {
+            std::cerr << "ERROR::STREAM_BUFFER::INVALID_REGION_COUNT: " << regionCount << std::endl;
+            return false;
+        }
+
+        glGenBuffers(1, &ID);
+        glBindBuffer(target, ID);
+
+        bufferStorage = hasBufferStorage() && loader
+            ? reinterpret_cast<BufferStorageProc>(loader("glBufferStorage"))
+            : nullptr;
+
+        if (bufferStorage) {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            bufferStorage(target, totalBytes, nullptr, flags);
+            persistentBase = static_cast<unsigned char*>(glMapBufferRange(target, 0, totalBytes, flags));
+            if (!persistentBase) {
+                std::cerr << "Persistent mapping failed, falling back to orphaning" << std::endl;
+                glDeleteBuffers(1, &ID);
+                glGenBuffers(1, &ID);
+                glBindBuffer(target, ID);
+                bufferStorage = nullptr;
+            }
+        }
+
+        if (!bufferStorage) {
+            glBufferData(target, totalBytes, nullptr, GL_STREAM_DRAW);
+        }
+
+        glBindBuffer(target, 0);
+        std::cout << "Stream buffer: " << regionCount << " x " << regionBytes << " bytes, "
+            << (isPersistent() ? "persistent mapped" : "orphaning fallback") << std::endl;
+        return true;
+    }
+
+    // Возвращает указатель на область текущего кадра.
+    // В persistent-режиме ждёт fence, оставленный этой областью regionCount кадров назад.
+    void* beginFrame() {
+        if (ID == 0) return nullptr;
+
+        if (isPersistent()) {
+            waitFence(current);
+            return persistentBase + regionOffset();
+        }
+
+        // Fallback: на каждом круге "осиротить" хранилище, затем писать без синхронизации
+        glBindBuffer(target, ID);
+        if (current == 0) {
+            glBufferData(target, totalBytes, nullptr, GL_STREAM_DRAW);
+        }
+        mappedRegion = glMapBufferRange(target, regionOffset(), regionBytes,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        glBindBuffer(target, 0);
+        return mappedRegion;
+    }
+
+    // Завершает запись CPU; после этого область можно использовать в draw-вызовах
+    void endWrite() {
+        if (isPersistent() || !mappedRegion) return;
+        glBindBuffer(target, ID);
+        glUnmapBuffer(target);
+        glBindBuffer(target, 0);
+        mappedRegion = nullptr;
+    }
+
+    // Ставит fence после всех команд, читающих текущую область, и переходит к следующей
+    void endFrame() {
+        if (ID == 0) return;
+        endWrite();
+        if (isPersistent()) {
+            if (fences[current]) glDeleteSync(fences[current]);
+            fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+        current = (current + 1) % regionCount;
+    }
+
+    GLintptr regionOffset() const { return static_cast<GLintptr>(regionBytes) * current; }
+    GLsizeiptr regionSize() const { return regionBytes; }
+    bool isPersistent() const { return persistentBase != nullptr; }
+
+    void destroy() {
+        for (int i = 0; i < MAX_REGIONS; i++) {
+            if (fences[i]) glDeleteSync(fences[i]);
+            fences[i] = 0;
+        }
+        if (ID != 0) {
+            if (persistentBase || mappedRegion) {
+                glBindBuffer(target, ID);
+                glUnmapBuffer(target);
+                glBindBuffer(target, 0);
+            }
+            glDeleteBuffers(1, &ID);
+        }
+        ID = 0;
+        persistentBase = nullptr;
+        mappedRegion = nullptr;
+        bufferStorage = nullptr;
+    }
+
+private:
+    typedef void (APIENTRYP BufferStorageProc)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+    static const int MAX_REGIONS = 4;
+
+    GLenum target = GL_ARRAY_BUFFER;
+    GLsizeiptr regionBytes = 0;
+    GLsizeiptr totalBytes = 0;
+    int regionCount = 3;
+    int current = 0;
+    GLsync fences[MAX_REGIONS] = {};
+    BufferStorageProc bufferStorage = nullptr;
+    unsigned char* persistentBase = nullptr;
+    void* mappedRegion = nullptr;
+
+    void waitFence(int region) {
+        if (!fences[region]) return;
+        GLbitfield waitFlags = 0;
+        GLuint64 timeout = 0;
+        for (;;) {
+            GLenum result = glClientWaitSync(fences[region], waitFlags, timeout);
+            if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED) break;
+            waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+            timeout = 1000000; // 1 ms
+        }
+        glDeleteSync(fences[region]);
+        fences[region] = 0;
+    }
+
+    static bool hasBufferStorage() {
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        if (major > 4 || (major == 4 && minor >= 4)) return true;
+
+        GLint extensionCount = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+        for (GLint i = 0; i < extensionCount; i++) {
+            const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            if (name && std::strcmp(name, "GL_ARB_buffer_storage") == 0) return true;
+        }
+        return false;
+    }
+};
@@ -0,0 +1,99 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Постоянный пул потоков для параллельных циклов внутри кадра.
+// parallelFor делит диапазон на равные части; вызывающий поток обрабатывает
+// первую часть сам и возвращается, когда готовы все.
+class ThreadPool {
+public:
+    // workerCount = 0: по числу ядер минус вызывающий поток
+    explicit ThreadPool(unsigned int workerCount = 0) {
+        if (workerCount == 0) {
+            unsigned int hardware = std::thread::hardware_concurrency();
+            workerCount = hardware > 1 ? hardware - 1 : 0;
+        }
+        for (unsigned int i = 0; i < workerCount; i++) {
+            workers.emplace_back(&ThreadPool::workerLoop, this, i + 1);
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    // Количество потоков, включая вызывающий
+    size_t threadCount() const { return workers.size() + 1; }
+
+    void parallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& body) {
+        if (count == 0) return;
+        size_t parts = std::min(threadCount(), count);
+        if (parts == 1) {
+            body(0, count);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &body;
+            jobCount = count;
+            jobParts = parts;
+            remaining = parts - 1;
+            generation++;
+        }
+        wake.notify_all();
+
+        body(0, count / parts);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return remaining == 0; });
+        job = nullptr;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(size_t, size_t)>* job = nullptr;
+    size_t jobCount = 0;
+    size_t jobParts = 0;
+    size_t remaining = 0;
+    unsigned long long generation = 0;
+    bool stopping = false;
+
+    void workerLoop(size_t part) {
+        unsigned long long seen = 0;
+        for (;;) {
+            const std::function<void(size_t, size_t)>* body;
+            size_t begin, end;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+                if (part >= jobParts) continue;
+                body = job;
+                begin = jobCount * part / jobParts;
+                end = jobCount * (part + 1) / jobParts;
+            }
+
+            (*body)(begin, end);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--remaining == 0) done.notify_one();
+        }
+    }
+};
@@ -1,15 +1,79 @@
 #version 330 core
 out vec4 FragColor;
+#ifdef IMPOSTOR_BAKE
+// Съёмка атласа импостеров (ImpostorAtlas.h): цвет и нормаль без освещения
+layout(location = 1) out vec4 FragNormal;
+#endif
 
 in vec3 FragPos;
 in vec3 Normal;
+flat in vec3 ObjectColor;
+flat in float ObjectFade;   // < 1 - персонаж переходит в импостер
 
 uniform vec3 lightPos;
 uniform vec3 lightColor;
-uniform vec3 objectColor;
 uniform vec3 viewPos;
+uniform mat4 view;
+
+// Clustered forward: точечные источники (см. ClusteredLights.h)
+uniform samplerBuffer lightData;        // 2 texel на источник: (позиция, радиус), (цвет * интенсивность)
+uniform usamplerBuffer clusterGrid;     // (offset, count) на кластер
+uniform usamplerBuffer lightIndexList;
+uniform ivec3 clusterDims;
+uniform vec2 clusterScreenSize;
+uniform float clusterNear;
+uniform float clusterSliceScale;
+uniform int pointLightCount;
+
+vec3 pointLighting(vec3 norm, vec3 viewDir) {
+    vec3 result = vec3(0.0);
+    if (pointLightCount == 0) return result;
+
+    float viewDepth = -(view * vec4(FragPos, 1.0)).z;
+    ivec2 tile = clamp(ivec2(gl_FragCoord.xy / clusterScreenSize * vec2(clusterDims.xy)), ivec2(0), clusterDims.xy - 1);
+    int slice = clamp(int(log(max(viewDepth, clusterNear) / clusterNear) * clusterSliceScale), 0, clusterDims.z - 1);
+    int cluster = (slice * clusterDims.y + tile.y) * clusterDims.x + tile.x;
+
+    uvec2 range = texelFetch(clusterGrid, cluster).xy;
+    for (uint i = 0u; i < range.y; i++) {
+        int light = int(texelFetch(lightIndexList, int(range.x + i)).r);
+        vec4 positionRadius = texelFetch(lightData, light * 2);
+        vec3 color = texelFetch(lightData, light * 2 + 1).rgb;
+
+        vec3 toLight = positionRadius.xyz - FragPos;
+        float distance2 = dot(toLight, toLight);
+        float radius2 = positionRadius.w * positionRadius.w;
+        if (distance2 >= radius2) continue;
+
+        // Плавное затухание до нуля на радиусе источника
+        float window = 1.0 - (distance2 * distance2) / (radius2 * radius2);
+        float attenuation = window * window / (distance2 + 1.0);
+
+        vec3 lightDir = toLight * inversesqrt(max(distance2, 1e-6));
+        float diff = max(dot(norm, lightDir), 0.0);
+        float spec = 0.5 * pow(max(dot(viewDir, reflect(-lightDir, norm)), 0.0), 32);
+        result += (diff + spec) * attenuation * color;
+    }
+    return result;
+}
+
+// Порог дизеринга 4x4 (Байер), тот же, что у импостеров
+float ditherThreshold() {
+    const float bayer[16] = float[16](0.0, 8.0, 2.0, 10.0, 12.0, 4.0, 14.0, 6.0,
+                                      3.0, 11.0, 1.0, 9.0, 15.0, 7.0, 13.0, 5.0);
+    ivec2 p = ivec2(gl_FragCoord.xy) & 3;
+    return (bayer[p.y * 4 + p.x] + 0.5) / 16.0;
+}
 
 void main() {
+#ifdef IMPOSTOR_BAKE
+    FragColor = vec4(ObjectColor, 1.0);
+    FragNormal = vec4(normalize(Normal) * 0.5 + 0.5, 1.0);
+    return;
+#endif
+    // Переход с импостером: геометрия оставляет долю ObjectFade пикселей
+    if (ObjectFade < 1.0 && ditherThreshold() >= ObjectFade) discard;
+
     // Ambient
     float ambientStrength = 0.3;
     vec3 ambient = ambientStrength * lightColor;
@@ -27,6 +91,6 @@ void main() {
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
     vec3 specular = specularStrength * spec * lightColor;
     
-    vec3 result = (ambient + diffuse + specular) * objectColor;
+    vec3 result = (ambient + diffuse + specular + pointLighting(norm, viewDir)) * ObjectColor;
     FragColor = vec4(result, 1.0);
-}
\ No newline at end of file
+}
@@ -0,0 +1,42 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+in vec3 FragPos;
+flat in float Yaw;
+flat in float Fade;
+
+uniform sampler2D albedoAtlas;  // цвет, альфа - покрытие
+uniform sampler2D normalAtlas;  // нормаль в системе персонажа, упакованная в 0..1
+uniform vec3 lightPos;
+uniform vec3 lightColor;
+uniform vec3 viewPos;
+
+// Порог дизеринга 4x4 (Байер), тот же, что у геометрии в fragment.glsl
+float ditherThreshold() {
+    const float bayer[16] = float[16](0.0, 8.0, 2.0, 10.0, 12.0, 4.0, 14.0, 6.0,
+                                      3.0, 11.0, 1.0, 9.0, 15.0, 7.0, 13.0, 5.0);
+    ivec2 p = ivec2(gl_FragCoord.xy) & 3;
+    return (bayer[p.y * 4 + p.x] + 0.5) / 16.0;
+}
+
+void main() {
+    vec4 albedo = texture(albedoAtlas, TexCoord);
+    if (albedo.a < 0.5) discard;
+    // При переходе импостер занимает пиксели, которые оставила геометрия
+    if (ditherThreshold() < 1.0 - Fade) discard;
+
+    // Нормаль из системы персонажа в мировую: поворот на Yaw вокруг вертикали
+    vec3 local = texture(normalAtlas, TexCoord).xyz * 2.0 - 1.0;
+    float c = cos(Yaw), s = sin(Yaw);
+    vec3 norm = normalize(vec3(c * local.x + s * local.z, local.y, -s * local.x + c * local.z));
+
+    // Освещение как у геометрии, без точечных источников: вдали их вклад не различим
+    vec3 ambient = 0.3 * lightColor;
+    vec3 lightDir = normalize(lightPos - FragPos);
+    vec3 diffuse = max(dot(norm, lightDir), 0.0) * lightColor;
+    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 specular = 0.5 * pow(max(dot(viewDir, reflect(-lightDir, norm)), 0.0), 32) * lightColor;
+
+    FragColor = vec4((ambient + diffuse + specular) * albedo.rgb, 1.0);
+}
@@ -0,0 +1,38 @@
+#version 330 core
+layout(location = 0) in vec2 aCorner;       // x: -0.5..0.5 по ширине, y: 0..1 по высоте
+layout(location = 1) in vec4 aPositionYaw;  // основание персонажа, поворот (радианы)
+layout(location = 2) in vec2 aPoseFade;     // поза в атласе, доля импостера при переходе
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 viewPos;
+uniform vec3 frame;         // ширина, низ и высота кадра съёмки относительно основания
+uniform ivec2 atlasGrid;    // ракурсов, поз
+
+out vec2 TexCoord;
+out vec3 FragPos;
+flat out float Yaw;
+flat out float Fade;
+
+const float TWO_PI = 6.28318530718;
+
+void main() {
+    vec3 base = aPositionYaw.xyz;
+    vec3 toCamera = viewPos - base;
+    toCamera.y = 0.0;
+    if (dot(toCamera, toCamera) < 1e-6) toCamera = vec3(0.0, 0.0, 1.0);
+
+    // Ракурс: направление на камеру в системе персонажа, округлённое до снятого
+    float angle = atan(toCamera.x, toCamera.z) - aPositionYaw.w;
+    int viewIndex = int(floor(angle / TWO_PI * float(atlasGrid.x) + 0.5));
+    viewIndex = ((viewIndex % atlasGrid.x) + atlasGrid.x) % atlasGrid.x;
+
+    // Вертикальный четырёхугольник, повёрнутый к камере; ось "вправо" как у камеры съёмки
+    vec3 right = normalize(vec3(toCamera.z, 0.0, -toCamera.x));
+    FragPos = base + right * aCorner.x * frame.x + vec3(0.0, frame.y + aCorner.y * frame.z, 0.0);
+    TexCoord = vec2((float(viewIndex) + aCorner.x + 0.5) / float(atlasGrid.x),
+        (aPoseFade.x + aCorner.y) / float(atlasGrid.y));
+    Yaw = aPositionYaw.w;
+    Fade = aPoseFade.y;
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -3,9 +3,6 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
 #include <iostream>
 #include <vector>
 #include <map>
@@ -13,7 +10,34 @@
 #include <fstream>
 #include <sstream>
 #include <cmath>
+#include <cstdlib>
 #include <random>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <list>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "Shader.h"
+#include "StreamBuffer.h"
+#include "SceneFile.h"
+#include "ObjReader.h"
+#include "ClusteredLights.h"
+#include "MeshSimplifier.h"
+#include "DynamicResolution.h"
+#include "FrameCapture.h"
+#include "HeadlessContext.h"
+#include "FrameArena.h"
+#include "InputQueue.h"
+#include "ImpostorAtlas.h"
+#include <functional>
+#include <memory>
+#include <chrono>
+#include <filesystem>
+#include <limits>
 
 // Window settings
 const unsigned int SCR_WIDTH = 1200;
@@ -47,6 +71,7 @@ bool isLeaningRight = false;
 float jumpVelocity = 0.0f;
 float characterHeight = 0.0f;
 float jumpHoldTime = 0.0f;
+float jumpStepTime = -1.0f;     // прыжок начат внутри шага: сколько он длится к концу шага
 const float gravity = -25.0f;
 const float baseJumpForce = 8.0f;
 const float maxJumpForce = 12.0f;
@@ -85,25 +110,85 @@ struct BoundingBox {
 struct Vertex {
     glm::vec3 position;
     glm::vec3 normal;
+    unsigned int joint;     // индекс кости в палитре; у жёстких мешей 0
 
-    Vertex() : position(0.0f), normal(0.0f) {}
-    Vertex(glm::vec3 pos, glm::vec3 norm) : position(pos), normal(norm) {}
+    Vertex() : position(0.0f), normal(0.0f), joint(0) {}
+    Vertex(glm::vec3 pos, glm::vec3 norm, unsigned int joint = 0) : position(pos), normal(norm), joint(joint) {}
 };
 
+// Память геометрии мешей, загруженных в GPU (для отчёта о политике хранения CPU-копий)
+struct GeometryMemory {
+    std::atomic<size_t> gpuBytes{ 0 };
+    std::atomic<size_t> cpuBytes{ 0 };        // CPU-копии, оставшиеся после загрузки
+    std::atomic<size_t> releasedBytes{ 0 };   // освобождено после загрузки за всё время
+};
+
+GeometryMemory geometryMemory;
+
 struct Mesh {
     unsigned int VAO = 0;
     unsigned int VBO = 0;
     unsigned int EBO = 0;
-    std::vector<Vertex> vertices;
+    std::vector<Vertex> vertices;       // CPU-копия; после загрузки обычно освобождается
     std::vector<unsigned int> indices;
+    GLsizei indexCount = 0;             // индексов в EBO, для отрисовки CPU-копия не нужна
+    size_t gpuBytes = 0;
+    size_t residentCpuBytes = 0;        // CPU-копия, учтённая в geometryMemory при загрузке
     glm::vec3 color = glm::vec3(0.7f, 0.6f, 0.8f);
 
+    // Уровни детализации: lods[i] - уровень i + 1, lodErrors[i] - его геометрическая ошибка
+    std::vector<Mesh> lods;
+    std::vector<float> lodErrors;
+    glm::vec3 boundsCenter = glm::vec3(0.0f);
+    float boundsRadius = 0.0f;
+
     Mesh() = default;
 
+    // GL-объекты принадлежат ровно одному Mesh: копирование запрещено, перемещение передаёт владение
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    Mesh(Mesh&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    Mesh& operator=(Mesh&& other) noexcept {
+        if (this != &other) {
+            cleanup();
+            VAO = other.VAO;
+            VBO = other.VBO;
+            EBO = other.EBO;
+            vertices = std::move(other.vertices);
+            indices = std::move(other.indices);
+            indexCount = other.indexCount;
+            gpuBytes = other.gpuBytes;
+            residentCpuBytes = other.residentCpuBytes;
+            color = other.color;
+            lods = std::move(other.lods);
+            lodErrors = std::move(other.lodErrors);
+            boundsCenter = other.boundsCenter;
+            boundsRadius = other.boundsRadius;
+            other.VAO = other.VBO = other.EBO = 0;
+            other.gpuBytes = other.residentCpuBytes = 0;
+        }
+        return *this;
+    }
+
     ~Mesh() {
         cleanup();
     }
 
+    size_t cpuBytes() const {
+        return vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int);
+    }
+
+    // Объём памяти: CPU-копия (если ещё есть) плюс буферы GPU, вместе с уровнями LOD
+    size_t memoryBytes() const {
+        size_t bytes = cpuBytes() + gpuBytes;
+        for (const auto& lod : lods) bytes += lod.memoryBytes();
+        return bytes;
+    }
+
     void setupMesh() {
         if (VAO != 0) return;
 
@@ -125,27 +210,69 @@ struct Mesh {
         glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
             (void*)offsetof(Vertex, normal));
         glEnableVertexAttribArray(1);
+        glVertexAttribIPointer(2, 1, GL_UNSIGNED_INT, sizeof(Vertex),
+            (void*)offsetof(Vertex, joint));
+        glEnableVertexAttribArray(2);
 
         glBindVertexArray(0);
+
+        indexCount = static_cast<GLsizei>(indices.size());
+        gpuBytes = vertices.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int);
+        residentCpuBytes = cpuBytes();
+        geometryMemory.gpuBytes += gpuBytes;
+        geometryMemory.cpuBytes += residentCpuBytes;
+    }
+
+    // Освобождает CPU-копию загруженного меша (см. applyGeometryResidency)
+    void releaseCpuGeometry() {
+        if (VAO == 0) return; // ещё не загружен: копия нужна для setupMesh
+        std::vector<Vertex>().swap(vertices);
+        std::vector<unsigned int>().swap(indices);
+        geometryMemory.cpuBytes -= residentCpuBytes;
+        geometryMemory.releasedBytes += residentCpuBytes;
+        residentCpuBytes = 0;
     }
 
     void cleanup() {
+        if (VAO != 0) {
+            geometryMemory.gpuBytes -= gpuBytes;
+            geometryMemory.cpuBytes -= residentCpuBytes;
+            gpuBytes = residentCpuBytes = 0;
+        }
         if (VAO != 0) glDeleteVertexArrays(1, &VAO);
         if (VBO != 0) glDeleteBuffers(1, &VBO);
         if (EBO != 0) glDeleteBuffers(1, &EBO);
+        VAO = VBO = EBO = 0;
     }
 };
 
+// Текущий LOD объекта между кадрами (для гистерезиса)
+struct LodSelection {
+    int level = 0;
+};
+
 // Модель с коллизией
 struct CollisionMesh {
-    Mesh mesh;
+    Mesh mesh;                          // собственный меш
+    const Mesh* sharedMesh = nullptr;   // или общий меш, принадлежащий миру
     BoundingBox bounds;
     glm::vec3 position;
-    std::string name;
+    glm::vec3 scale;
+    glm::vec3 color;
+    ObstacleType type;
+    mutable LodSelection lod;
+
+    CollisionMesh() : position(0.0f), scale(1.0f), color(0.7f, 0.6f, 0.8f), type(ObstacleType::Box) {}
+    CollisionMesh(Mesh&& m, const BoundingBox& b, const glm::vec3& pos = glm::vec3(0.0f), ObstacleType t = ObstacleType::Box)
+        : mesh(std::move(m)), bounds(b), position(pos), scale(1.0f), color(mesh.color), type(t) {
+    }
+    CollisionMesh(const Mesh* shared, const glm::vec3& s, const glm::vec3& c, const BoundingBox& b,
+        const glm::vec3& pos, ObstacleType t)
+        : sharedMesh(shared), bounds(b), position(pos), scale(s), color(c), type(t) {
+    }
 
-    CollisionMesh() : position(0.0f), name("unknown") {}
-    CollisionMesh(const Mesh& m, const BoundingBox& b, const glm::vec3& pos = glm::vec3(0.0f), const std::string& n = "unknown")
-        : mesh(m), bounds(b), position(pos), name(n) {
+    const Mesh& renderMesh() const {
+        return sharedMesh ? *sharedMesh : mesh;
     }
 
     BoundingBox getWorldBounds() const {
@@ -153,127 +280,233 @@ struct CollisionMesh {
     }
 };
 
-// Shader class
-class Shader {
-public:
-    unsigned int ID = 0;
+// Данные одного объекта в ObjectBlock (std140, см. vertex.glsl)
+struct ObjectData {
+    glm::mat4 model;
+    glm::vec4 color;
+};
 
-    Shader() = default;
+const int MAX_OBJECTS_PER_BATCH = 128;     // размер ObjectBlock в vertex.glsl
+const unsigned int OBJECT_BLOCK_BINDING = 0;
 
-    Shader(const char* vertexPath, const char* fragmentPath) {
-        load(vertexPath, fragmentPath);
+// Очередь отрисовки кадра.
+// Матрицы пишутся сразу в память StreamBuffer, видимую GPU; draw-вызовы
+// откладываются до flush(), где область привязывается один раз.
+// Когда область заполнена, накопленное рисуется и запись продолжается в следующей
+// области кольца, так что число объектов в кадре не ограничено размером ObjectBlock.
+class RenderQueue {
+public:
+    bool init(const Shader& shader, StreamBuffer::LoadProc loader) {
+        GLint alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        if (!objectBuffer.create(GL_UNIFORM_BUFFER, sizeof(ObjectData) * MAX_OBJECTS_PER_BATCH, alignment, loader)) {
+            return false;
+        }
+        shader.bindUniformBlock("ObjectBlock", OBJECT_BLOCK_BINDING);
+        objectIndexLocation = glGetUniformLocation(shader.ID, "objectIndex");
+        instanceStrideLocation = glGetUniformLocation(shader.ID, "instanceStride");
+        setLodCamera(glm::vec3(0.0f), glm::mat4(1.0f), 1.0f);
+        return true;
     }
 
-    bool load(const char* vertexPath, const char* fragmentPath) {
-        std::string vertexCode, fragmentCode;
-        std::ifstream vShaderFile, fShaderFile;
-
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    // Команды кадра живут в арене кадра до flush()
+    void begin(FrameArena& arena) {
+        objects = static_cast<ObjectData*>(objectBuffer.beginFrame());
+        objectCount = 0;
+        draws = arena.allocate<DrawCommand>(MAX_OBJECTS_PER_BATCH);
+        drawCount = 0;
+    }
 
-        try {
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
+    // Параметры выбора LOD на кадр: уровень берётся самый грубый,
+    // чья ошибка на экране не превышает lodPixelError пикселей
+    void setLodCamera(const glm::vec3& position, const glm::mat4& projection, float viewportHeight) {
+        lodCameraPosition = position;
+        lodPixelScale = projection[1][1] * viewportHeight * 0.5f;
+    }
 
-            std::stringstream vShaderStream, fShaderStream;
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
+    void submit(const Mesh& mesh, const glm::mat4& transform, LodSelection* lod = nullptr) {
+        submit(mesh, transform, mesh.color, lod);
+    }
 
-            vShaderFile.close();
-            fShaderFile.close();
+    // fade < 1: доля пикселей, которые объект оставляет при переходе в импостер (дизеринг)
+    void submit(const Mesh& sourceMesh, const glm::mat4& transform, const glm::vec3& color, LodSelection* lod = nullptr,
+        float fade = 1.0f) {
+        if (!objects) return;
+        const Mesh& mesh = selectLod(sourceMesh, transform, lod);
+        if (!reserveObjects(1)) return;
+
+        ObjectData& object = objects[objectCount];
+        object.model = transform;
+        object.color = glm::vec4(color, fade);
+        draws[drawCount++] = { mesh.VAO, mesh.indexCount, static_cast<GLint>(objectCount), 1, 0 };
+        objectCount++;
+    }
 
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
-        }
-        catch (std::ifstream::failure& e) {
-            std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
-            return false;
+    // Скиннинговый меш: палитра по jointCount записей ObjectBlock на экземпляр, экземпляры подряд.
+    // Вершина берёт запись objectIndex + gl_InstanceID * jointCount + joint. Экземпляры, которые
+    // помещаются в одну область, рисуются одним вызовом; остальные - следующими
+    void submitSkinned(const Mesh& mesh, const glm::mat4* palette, const glm::vec3* jointColors,
+        int jointCount, int instanceCount = 1, float fade = 1.0f) {
+        if (!objects || jointCount <= 0 || instanceCount <= 0) return;
+        if (jointCount > MAX_OBJECTS_PER_BATCH) {
+            std::cerr << "ERROR::RENDER_QUEUE::PALETTE_TOO_LARGE: " << jointCount << " joints" << std::endl;
+            return;
         }
 
-        const char* vShaderCode = vertexCode.c_str();
-        const char* fShaderCode = fragmentCode.c_str();
+        while (instanceCount > 0) {
+            int batchInstances = std::min(instanceCount, MAX_OBJECTS_PER_BATCH / jointCount);
+            size_t count = static_cast<size_t>(jointCount) * batchInstances;
+            if (!reserveObjects(count)) return;
 
-        unsigned int vertex, fragment;
-
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        if (!checkCompileErrors(vertex, "VERTEX")) return false;
-
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        if (!checkCompileErrors(fragment, "FRAGMENT")) {
-            glDeleteShader(vertex);
-            return false;
-        }
-
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        glLinkProgram(ID);
-        if (!checkCompileErrors(ID, "PROGRAM")) {
-            glDeleteShader(vertex);
-            glDeleteShader(fragment);
-            ID = 0;
-            return false;
+            for (size_t i = 0; i < count; i++) {
+                ObjectData& object = objects[objectCount + i];
+                object.model = palette[i];
+                object.color = glm::vec4(jointColors[i % jointCount], fade);
+            }
+            draws[drawCount++] = { mesh.VAO, mesh.indexCount, static_cast<GLint>(objectCount),
+                static_cast<GLsizei>(batchInstances), jointCount };
+            objectCount += count;
+            palette += count;
+            instanceCount -= batchInstances;
         }
+    }
 
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        return true;
+    void flush() {
+        drawBatch();
+        objects = nullptr;
+        draws = nullptr;
     }
 
-    void use() {
-        if (ID != 0) glUseProgram(ID);
+    // Освобождает GL-ресурсы, пока контекст ещё жив
+    void destroy() {
+        objectBuffer.destroy();
+        objects = nullptr;
     }
 
-    void setMat4(const std::string& name, const glm::mat4& mat) const {
-        if (ID != 0) {
-            glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+private:
+    // Рисует накопленное из текущей области и закрывает её fence'ом
+    void drawBatch() {
+        objectBuffer.endWrite();
+        glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_BLOCK_BINDING, objectBuffer.ID,
+            objectBuffer.regionOffset(), objectBuffer.regionSize());
+
+        unsigned int boundVAO = 0;
+        GLint boundStride = -1;
+        for (size_t i = 0; i < drawCount; i++) {
+            const DrawCommand& draw = draws[i];
+            if (draw.VAO != boundVAO) {
+                glBindVertexArray(draw.VAO);
+                boundVAO = draw.VAO;
+            }
+            if (draw.instanceStride != boundStride) {
+                glUniform1i(instanceStrideLocation, draw.instanceStride);
+                boundStride = draw.instanceStride;
+            }
+            glUniform1i(objectIndexLocation, draw.firstObject);
+            if (draw.instanceCount > 1) {
+                glDrawElementsInstanced(GL_TRIANGLES, draw.indexCount, GL_UNSIGNED_INT, 0, draw.instanceCount);
+            }
+            else {
+                glDrawElements(GL_TRIANGLES, draw.indexCount, GL_UNSIGNED_INT, 0);
+            }
         }
+        glBindVertexArray(0);
+
+        objectBuffer.endFrame();
+        objectCount = 0;
+        drawCount = 0;
     }
 
-    void setVec3(const std::string& name, const glm::vec3& value) const {
-        if (ID != 0) {
-            glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    // Размер объекта на экране (пикселей на единицу длины) умножается на ошибку каждого уровня.
+    // Гистерезис: огрубление требует запаса, возврат к текущему и более точным уровням - нет
+    const Mesh& selectLod(const Mesh& mesh, const glm::mat4& transform, LodSelection* lod) const {
+        if (mesh.lods.empty()) return mesh;
+
+        glm::vec3 center = glm::vec3(transform * glm::vec4(mesh.boundsCenter, 1.0f));
+        float scale = glm::max(glm::length(glm::vec3(transform[0])),
+            glm::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+        float distance = glm::max(glm::length(center - lodCameraPosition) - mesh.boundsRadius * scale, 0.1f);
+        float pixelsPerUnit = lodPixelScale * scale / distance;
+
+        int current = lod ? lod->level : 0;
+        int level = 0;
+        for (size_t i = 0; i < mesh.lods.size(); i++) {
+            int candidate = static_cast<int>(i) + 1;
+            float limit = lodPixelError * (candidate > current ? 1.0f - lodHysteresis : 1.0f + lodHysteresis);
+            if (mesh.lodErrors[i] * pixelsPerUnit > limit) break;
+            level = candidate;
         }
+
+        if (lod) lod->level = level;
+        return level == 0 ? mesh : mesh.lods[level - 1];
     }
 
-    void setFloat(const std::string& name, float value) const {
-        if (ID != 0) {
-            glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
-        }
+    // Если count записей не помещается в область, рисует накопленное и переходит к следующей.
+    // false - следующую область не удалось отобразить
+    bool reserveObjects(size_t count) {
+        if (objectCount + count <= static_cast<size_t>(MAX_OBJECTS_PER_BATCH)) return true;
+        drawBatch();
+        objects = static_cast<ObjectData*>(objectBuffer.beginFrame());
+        return objects != nullptr;
     }
 
-private:
-    bool checkCompileErrors(unsigned int shader, std::string type) {
-        int success;
-        char infoLog[1024];
-        if (type != "PROGRAM") {
-            glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-            if (!success) {
-                glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-                std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n";
-                return false;
-            }
+    struct DrawCommand {
+        unsigned int VAO;
+        GLsizei indexCount;
+        GLint firstObject;      // первая запись ObjectBlock
+        GLsizei instanceCount;
+        GLint instanceStride;   // записей на экземпляр (0 у жёстких мешей)
+    };
+
+    StreamBuffer objectBuffer;
+    ObjectData* objects = nullptr;
+    size_t objectCount = 0;
+    glm::vec3 lodCameraPosition = glm::vec3(0.0f);
+    float lodPixelScale = 1.0f;
+    float lodPixelError = 1.0f;
+    float lodHysteresis = 0.25f;
+    DrawCommand* draws = nullptr;   // в арене кадра, MAX_OBJECTS_PER_BATCH штук, общие для всех областей кадра
+    size_t drawCount = 0;
+    GLint objectIndexLocation = -1;
+    GLint instanceStrideLocation = -1;
+};
+
+// Система коллизий
+typedef unsigned int ObstacleId;
+
+// Пирамида видимости: шесть плоскостей из projection * view (метод Gribb-Hartmann)
+struct Frustum {
+    glm::vec4 planes[6];
+
+    explicit Frustum(const glm::mat4& viewProjection) {
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; i++) {
+            rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
         }
-        else {
-            glGetProgramiv(shader, GL_LINK_STATUS, &success);
-            if (!success) {
-                glGetProgramInfoLog(shader, 1024, NULL, infoLog);
-                std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n";
-                return false;
-            }
+        for (int i = 0; i < 3; i++) {
+            planes[i * 2] = rows[3] + rows[i];
+            planes[i * 2 + 1] = rows[3] - rows[i];
+        }
+    }
+
+    // AABB невидим, если целиком лежит за одной из плоскостей
+    bool intersects(const BoundingBox& box) const {
+        for (const auto& plane : planes) {
+            glm::vec3 farthest(plane.x > 0.0f ? box.max.x : box.min.x,
+                plane.y > 0.0f ? box.max.y : box.min.y,
+                plane.z > 0.0f ? box.max.z : box.min.z);
+            if (glm::dot(glm::vec3(plane), farthest) + plane.w < 0.0f) return false;
         }
         return true;
     }
 };
 
-// Система коллизий
 class CollisionSystem {
 private:
     std::vector<CollisionMesh> obstacles;
+    std::vector<ObstacleId> obstacleIds;
+    std::unordered_map<ObstacleId, size_t> obstacleIndex;
+    ObstacleId nextObstacleId = 1;
     BoundingBox characterBounds;
 
 public:
@@ -282,8 +515,33 @@ public:
         characterBounds = BoundingBox(glm::vec3(-0.3f, 0.0f, -0.3f), glm::vec3(0.3f, 1.8f, 0.3f));
     }
 
-    void addObstacle(const CollisionMesh& obstacle) {
-        obstacles.push_back(obstacle);
+    ObstacleId addObstacle(CollisionMesh&& obstacle) {
+        ObstacleId id = nextObstacleId++;
+        obstacleIndex[id] = obstacles.size();
+        obstacleIds.push_back(id);
+        obstacles.push_back(std::move(obstacle));
+        return id;
+    }
+
+    // Удаление за O(1): последний элемент переносится на место удалённого
+    void removeObstacle(ObstacleId id) {
+        auto found = obstacleIndex.find(id);
+        if (found == obstacleIndex.end()) return;
+
+        size_t index = found->second;
+        size_t last = obstacles.size() - 1;
+        if (index != last) {
+            obstacles[index] = std::move(obstacles[last]);
+            obstacleIds[index] = obstacleIds[last];
+            obstacleIndex[obstacleIds[index]] = index;
+        }
+        obstacles.pop_back();
+        obstacleIds.pop_back();
+        obstacleIndex.erase(found);
+    }
+
+    size_t obstacleCount() const {
+        return obstacles.size();
     }
 
     void setCharacterBounds(const BoundingBox& bounds) {
@@ -326,26 +584,42 @@ public:
         return oldPos;
     }
 
-    void drawObstacles(Shader& shader) const {
-        for (const auto& obstacle : obstacles) {
+    // Отсекает препятствия вне пирамиды видимости; список видимых живёт в арене кадра
+    // и сортируется по мешу, чтобы реже переключать VAO. Возвращает число видимых
+    size_t drawObstacles(RenderQueue& queue, const Frustum& frustum, FrameArena& arena) const {
+        uint32_t* visible = arena.allocate<uint32_t>(obstacles.size());
+        size_t visibleCount = 0;
+        for (uint32_t i = 0; i < obstacles.size(); i++) {
+            BoundingBox bounds = obstacles[i].getWorldBounds();
+            // Запас на смещение арок и лестниц при отрисовке
+            bounds.min.y -= 1.0f;
+            bounds.max.y += 1.0f;
+            if (frustum.intersects(bounds)) visible[visibleCount++] = i;
+        }
+        std::sort(visible, visible + visibleCount, [this](uint32_t a, uint32_t b) {
+            return &obstacles[a].renderMesh() < &obstacles[b].renderMesh();
+        });
+
+        for (size_t i = 0; i < visibleCount; i++) {
+            const CollisionMesh& obstacle = obstacles[visible[i]];
             glm::mat4 transform = glm::translate(glm::mat4(1.0f), obstacle.position);
 
             // Специальные трансформации для разных типов препятствий
-            if (obstacle.name.find("arch") != std::string::npos) {
+            if (obstacle.type == ObstacleType::Arch) {
                 // Арка - добавляем немного высоты
                 transform = glm::translate(transform, glm::vec3(0.0f, 1.0f, 0.0f));
             }
-            else if (obstacle.name.find("stairs") != std::string::npos) {
+            else if (obstacle.type == ObstacleType::Stairs) {
                 // Лестница
                 transform = glm::translate(transform, glm::vec3(0.0f, -0.5f, 0.0f));
             }
 
-            shader.setMat4("model", transform);
-            shader.setVec3("objectColor", obstacle.mesh.color);
-            glBindVertexArray(obstacle.mesh.VAO);
-            glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(obstacle.mesh.indices.size()), GL_UNSIGNED_INT, 0);
-            glBindVertexArray(0);
+            if (obstacle.sharedMesh) {
+                transform = glm::scale(transform, obstacle.scale);
+            }
+            queue.submit(obstacle.renderMesh(), transform, obstacle.color, &obstacle.lod);
         }
+        return visibleCount;
     }
 };
 
@@ -371,7 +645,7 @@ Mesh createCubeMesh(const glm::vec3& color = glm::vec3(0.7f, 0.6f, 0.8f)) {
         3, 2, 6, 6, 7, 3, 0, 1, 5, 5, 4, 0
     };
 
-    mesh.setupMesh();
+    // setupMesh() вызывает тот, кто придаёт кубу окончательную форму
     return mesh;
 }
 
@@ -384,6 +658,7 @@ Mesh createTorsoMesh() {
         vertex.position.z *= 0.2f;
         vertex.position.y += 0.4f;
     }
+    torso.setupMesh();
     return torso;
 }
 
@@ -395,6 +670,7 @@ Mesh createHeadMesh() {
         vertex.position.z *= 0.2f;
         vertex.position.y += 1.2f;
     }
+    head.setupMesh();
     return head;
 }
 
@@ -406,6 +682,7 @@ Mesh createArmMesh(bool isLeft = true, const glm::vec3& color = glm::vec3(0.2f,
         vertex.position.z *= 0.1f;
         vertex.position.y -= 0.3f;
     }
+    arm.setupMesh();
     return arm;
 }
 
@@ -417,85 +694,394 @@ Mesh createLegMesh(bool isLeft = true, const glm::vec3& color = glm::vec3(0.3f,
         vertex.position.z *= 0.1f;
         vertex.position.y -= 0.3f;
     }
+    leg.setupMesh();
     return leg;
 }
 
-// Load OBJ with Assimp or create fallback
-bool loadOBJ(const std::string& path, Mesh& mesh, const glm::vec3& color = glm::vec3(0.7f, 0.6f, 0.8f)) {
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenNormals);
+// Копирует объект OBJ в конец меша, сдвигая индексы
+void appendObjObject(Mesh& mesh, const ObjObject& object) {
+    unsigned int base = static_cast<unsigned int>(mesh.vertices.size());
+    mesh.vertices.reserve(mesh.vertices.size() + object.positions.size());
+    for (size_t i = 0; i < object.positions.size(); i++) {
+        mesh.vertices.emplace_back(object.positions[i], object.normals[i]);
+    }
+    mesh.indices.reserve(mesh.indices.size() + object.indices.size());
+    for (unsigned int index : object.indices) {
+        mesh.indices.push_back(base + index);
+    }
+}
 
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-        std::cerr << "Creating fallback geometry for: " << path << std::endl;
+bool readOBJ(const std::string& path, std::vector<ObjObject>& objects) {
+    auto startTime = std::chrono::steady_clock::now();
+    ObjReader reader;
+    if (!reader.read(path, objects)) {
+        std::cerr << "ERROR::OBJ::" << reader.error() << std::endl;
+        return false;
+    }
 
-        if (path.find("torso") != std::string::npos) mesh = createTorsoMesh();
-        else if (path.find("head") != std::string::npos) mesh = createHeadMesh();
-        else if (path.find("left_arm") != std::string::npos) mesh = createArmMesh(true, color);
-        else if (path.find("right_arm") != std::string::npos) mesh = createArmMesh(false, color);
-        else if (path.find("left_leg") != std::string::npos) mesh = createLegMesh(true, color);
-        else if (path.find("right_leg") != std::string::npos) mesh = createLegMesh(false, color);
-        else mesh = createCubeMesh(color);
+    size_t vertexCount = 0, triangleCount = 0;
+    for (const auto& object : objects) {
+        vertexCount += object.positions.size();
+        triangleCount += object.indices.size() / 3;
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "Loaded " << path << ": " << objects.size() << " object(s), " << vertexCount << " vertices, "
+        << triangleCount << " triangles in " << ms << " ms (" << reader.threadCount() << " thread(s))" << std::endl;
+    return true;
+}
 
-        return true;
+// Load OBJ (all objects merged into one mesh).
+// On failure the error is reported and the mesh is built by fallback, if one is given.
+bool loadOBJ(const std::string& path, Mesh& mesh, const glm::vec3& color = glm::vec3(0.7f, 0.6f, 0.8f),
+    const std::function<Mesh()>& fallback = nullptr) {
+    std::vector<ObjObject> objects;
+    if (!readOBJ(path, objects)) {
+        if (fallback) {
+            std::cerr << "Using built-in fallback geometry for: " << path << std::endl;
+            mesh = fallback();
+            mesh.setupMesh();
+        }
+        return false;
     }
 
-    if (scene->mNumMeshes == 0) return false;
+    mesh = Mesh();
+    for (const auto& object : objects) {
+        appendObjObject(mesh, object);
+    }
+    mesh.color = color;
+    mesh.setupMesh();
+    return true;
+}
 
-    aiMesh* ai_mesh = scene->mMeshes[0];
-    mesh.vertices.clear();
-    mesh.indices.clear();
+// Генерация LOD при импорте: каждый уровень примерно вдвое грубее предыдущего.
+// Вершины уровней получают плоские нормали граней, как и меши из OBJ.
+void generateLods(Mesh& mesh, const std::string& name, const std::vector<float>& ratios = { 0.5f, 0.25f, 0.12f }) {
+    mesh.lods.clear();
+    mesh.lodErrors.clear();
+    if (mesh.vertices.empty() || mesh.indices.empty()) return;
+    // Упрощение не сохраняет привязку к костям: скиннинговые меши остаются с одним уровнем
+    for (const auto& vertex : mesh.vertices) {
+        if (vertex.joint != 0) return;
+    }
 
-    for (unsigned int i = 0; i < ai_mesh->mNumVertices; i++) {
-        Vertex vertex;
-        vertex.position = glm::vec3(ai_mesh->mVertices[i].x, ai_mesh->mVertices[i].y, ai_mesh->mVertices[i].z);
+    glm::vec3 boundsMin = mesh.vertices[0].position, boundsMax = boundsMin;
+    std::vector<glm::vec3> positions;
+    positions.reserve(mesh.vertices.size());
+    for (const auto& vertex : mesh.vertices) {
+        positions.push_back(vertex.position);
+        boundsMin = glm::min(boundsMin, vertex.position);
+        boundsMax = glm::max(boundsMax, vertex.position);
+    }
+    mesh.boundsCenter = (boundsMin + boundsMax) * 0.5f;
+    mesh.boundsRadius = 0.0f;
+    for (const auto& position : positions) {
+        mesh.boundsRadius = glm::max(mesh.boundsRadius, glm::length(position - mesh.boundsCenter));
+    }
 
-        if (ai_mesh->HasNormals()) {
-            vertex.normal = glm::vec3(ai_mesh->mNormals[i].x, ai_mesh->mNormals[i].y, ai_mesh->mNormals[i].z);
+    MeshSimplifier simplifier(positions, mesh.indices);
+    size_t sourceTriangles = simplifier.triangleCount();
+    size_t previousTriangles = sourceTriangles;
+    std::ostringstream report;
+    report << "LOD " << name << ": " << sourceTriangles;
+
+    for (float ratio : ratios) {
+        size_t target = std::max(static_cast<size_t>(sourceTriangles * ratio), static_cast<size_t>(4));
+        simplifier.simplify(target);
+        // Уровень, который почти не проще предыдущего, не нужен
+        if (simplifier.triangleCount() * 5 > previousTriangles * 4) break;
+        previousTriangles = simplifier.triangleCount();
+
+        std::vector<glm::vec3> lodPositions;
+        std::vector<unsigned int> lodIndices;
+        simplifier.extract(lodPositions, lodIndices);
+
+        Mesh lod;
+        lod.color = mesh.color;
+        lod.vertices.reserve(lodIndices.size());
+        for (size_t i = 0; i + 2 < lodIndices.size(); i += 3) {
+            const glm::vec3& a = lodPositions[lodIndices[i]];
+            const glm::vec3& b = lodPositions[lodIndices[i + 1]];
+            const glm::vec3& c = lodPositions[lodIndices[i + 2]];
+            glm::vec3 normal = glm::cross(b - a, c - a);
+            normal = glm::length(normal) > 1e-12f ? glm::normalize(normal) : glm::vec3(0.0f, 1.0f, 0.0f);
+            for (const glm::vec3* corner : { &a, &b, &c }) {
+                lod.indices.push_back(static_cast<unsigned int>(lod.vertices.size()));
+                lod.vertices.emplace_back(*corner, normal);
+            }
         }
-        else {
-            vertex.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+        lod.setupMesh();
+
+        mesh.lods.push_back(std::move(lod));
+        mesh.lodErrors.push_back(simplifier.error());
+        report << " / " << previousTriangles << " (err " << simplifier.error() << ")";
+    }
+
+    report << " triangles";
+    std::cout << report.str() << std::endl;
+}
+
+// Политика хранения CPU-геометрии: после загрузки в GPU вершины и индексы нужны только
+// точной коллизии по треугольникам и построению LOD. CollisionSystem проверяет AABB
+// (CollisionMesh::bounds), LOD строятся при импорте - обычно копия освобождается сразу.
+// Уровни LOD из исходных данных больше не строятся, их копии не нужны никогда.
+void applyGeometryResidency(Mesh& mesh, bool neededForCollision = false, bool neededForLod = false) {
+    for (auto& lod : mesh.lods) lod.releaseCpuGeometry();
+    if (neededForCollision || neededForLod) return;
+    mesh.releaseCpuGeometry();
+}
+
+// Отчёт о памяти геометрии: сколько CPU-копий было бы без политики и сколько осталось
+void reportGeometryMemory(const char* when) {
+    size_t cpu = geometryMemory.cpuBytes, released = geometryMemory.releasedBytes, gpu = geometryMemory.gpuBytes;
+    std::cout << "Geometry memory " << when << ": CPU copies " << (cpu + released) / 1024.0 << " KB before release, "
+        << cpu / 1024.0 << " KB after; GPU buffers " << gpu / 1024.0 << " KB" << std::endl;
+}
+
+// Draw mesh function
+void drawMesh(RenderQueue& queue, const Mesh& mesh, const glm::mat4& transform, LodSelection* lod = nullptr) {
+    queue.submit(mesh, transform, lod);
+}
+
+// Скелет цельного бипеда (biped.obj); порядок костей совпадает с палитрой
+enum class BipedJoint : uint32_t {
+    Torso = 0,
+    Head,
+    LeftArm,
+    RightArm,
+    LeftLeg,
+    RightLeg,
+    Count
+};
+
+const int BIPED_JOINT_COUNT = static_cast<int>(BipedJoint::Count);
+
+struct BipedJointDesc {
+    const char* name;
+    glm::vec3 start;        // сустав в пространстве biped.obj
+    glm::vec3 end;          // конец кости, по отрезку start-end привязываются вершины
+    glm::mat4 rest;         // трансформ части из анимации в покое (относительно characterBase)
+    glm::vec3 rigPivot;     // точка вращения той же части в анимации
+};
+
+const BipedJointDesc* bipedJoints() {
+    const glm::mat4 identity(1.0f);
+    static const BipedJointDesc joints[BIPED_JOINT_COUNT] = {
+        { "torso", glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(0.0f, 1.2f, 0.0f),
+            glm::translate(identity, glm::vec3(0.0f, 0.3f, 0.0f)), glm::vec3(0.0f, 0.3f, 0.0f) },
+        { "head", glm::vec3(0.0f, 1.2f, 0.0f), glm::vec3(0.0f, 1.5f, 0.0f),
+            glm::translate(identity, glm::vec3(0.0f, 0.5f, 0.0f)), glm::vec3(0.0f, 0.5f, 0.0f) },
+        { "left_arm", glm::vec3(-0.2f, 1.0f, 0.0f), glm::vec3(-0.4f, 0.6f, 0.0f),
+            glm::rotate(glm::translate(identity, glm::vec3(-0.25f, 0.7f, 0.0f)), glm::radians(10.0f), glm::vec3(0, 0, 1)),
+            glm::vec3(-0.25f, 0.7f, 0.0f) },
+        { "right_arm", glm::vec3(0.2f, 1.0f, 0.0f), glm::vec3(0.4f, 0.6f, 0.0f),
+            glm::rotate(glm::translate(identity, glm::vec3(0.25f, 0.7f, 0.0f)), glm::radians(-10.0f), glm::vec3(0, 0, 1)),
+            glm::vec3(0.25f, 0.7f, 0.0f) },
+        { "left_leg", glm::vec3(-0.15f, 0.5f, 0.0f), glm::vec3(-0.15f, 0.0f, 0.0f),
+            glm::translate(identity, glm::vec3(-0.12f, -0.2f, 0.0f)), glm::vec3(-0.12f, 0.1f, 0.0f) },
+        { "right_leg", glm::vec3(0.15f, 0.5f, 0.0f), glm::vec3(0.15f, 0.0f, 0.0f),
+            glm::translate(identity, glm::vec3(0.12f, -0.2f, 0.0f)), glm::vec3(0.12f, 0.1f, 0.0f) }
+    };
+    return joints;
+}
+
+float distanceToSegment(const glm::vec3& point, const glm::vec3& a, const glm::vec3& b) {
+    glm::vec3 ab = b - a;
+    float t = glm::clamp(glm::dot(point - a, ab) / glm::max(glm::dot(ab, ab), 1e-12f), 0.0f, 1.0f);
+    return glm::length(point - (a + ab * t));
+}
+
+// Жёсткая привязка: каждый связный кусок меша целиком достаётся кости, ближайшей к его центру.
+// Связность берётся по индексам v из файла, а не по совпадению позиций: нога, касающаяся
+// туловища углом, остаётся отдельным куском. Если какой-то кости не досталось ни одной
+// вершины, привязка не удалась
+bool assignBipedJoints(Mesh& mesh, const std::vector<unsigned int>& sourcePositions) {
+    std::vector<unsigned int> parent(mesh.vertices.size());
+    for (unsigned int i = 0; i < parent.size(); i++) parent[i] = i;
+    auto find = [&](unsigned int v) {
+        while (parent[v] != v) v = parent[v] = parent[parent[v]];
+        return v;
+    };
+    auto unite = [&](unsigned int a, unsigned int b) { parent[find(a)] = find(b); };
+
+    std::unordered_map<unsigned int, unsigned int> shared;
+    for (unsigned int i = 0; i < mesh.vertices.size(); i++) {
+        auto inserted = shared.emplace(sourcePositions[i], i);
+        if (!inserted.second) unite(i, inserted.first->second);
+    }
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        unite(mesh.indices[i], mesh.indices[i + 1]);
+        unite(mesh.indices[i + 1], mesh.indices[i + 2]);
+    }
+
+    std::unordered_map<unsigned int, std::pair<glm::vec3, unsigned int>> pieces;
+    for (unsigned int i = 0; i < mesh.vertices.size(); i++) {
+        auto& piece = pieces[find(i)];
+        piece.first += mesh.vertices[i].position;
+        piece.second++;
+    }
+
+    const BipedJointDesc* joints = bipedJoints();
+    std::unordered_map<unsigned int, unsigned int> pieceJoint;
+    for (const auto& piece : pieces) {
+        glm::vec3 center = piece.second.first / static_cast<float>(piece.second.second);
+        unsigned int best = 0;
+        float bestDistance = std::numeric_limits<float>::max();
+        for (unsigned int j = 0; j < BIPED_JOINT_COUNT; j++) {
+            float distance = distanceToSegment(center, joints[j].start, joints[j].end);
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                best = j;
+            }
         }
+        pieceJoint[piece.first] = best;
+    }
 
-        mesh.vertices.push_back(vertex);
+    int vertexCount[BIPED_JOINT_COUNT] = {};
+    for (unsigned int i = 0; i < mesh.vertices.size(); i++) {
+        mesh.vertices[i].joint = pieceJoint[find(i)];
+        vertexCount[mesh.vertices[i].joint]++;
     }
 
-    for (unsigned int i = 0; i < ai_mesh->mNumFaces; i++) {
-        aiFace face = ai_mesh->mFaces[i];
-        for (unsigned int j = 0; j < face.mNumIndices; j++) {
-            mesh.indices.push_back(face.mIndices[j]);
+    std::cout << "Biped skin: " << pieces.size() << " piece(s);";
+    for (int j = 0; j < BIPED_JOINT_COUNT; j++) {
+        std::cout << " " << joints[j].name << " " << vertexCount[j];
+    }
+    std::cout << " vertices" << std::endl;
+
+    for (int j = 0; j < BIPED_JOINT_COUNT; j++) {
+        if (vertexCount[j] == 0) {
+            std::cerr << "ERROR::BIPED::NO_VERTICES_FOR_JOINT: " << joints[j].name << std::endl;
+            return false;
         }
     }
+    return true;
+}
 
-    mesh.color = color;
+// Цельный бипед для скиннинга: все объекты OBJ в одном меше с индексом кости в каждой вершине
+bool loadSkinnedBiped(const std::string& path, Mesh& mesh) {
+    std::vector<ObjObject> objects;
+    if (!readOBJ(path, objects)) return false;
+
+    mesh = Mesh();
+    std::vector<unsigned int> sourcePositions;
+    for (const auto& object : objects) {
+        appendObjObject(mesh, object);
+        sourcePositions.insert(sourcePositions.end(), object.sourcePositions.begin(), object.sourcePositions.end());
+    }
+    if (mesh.indices.empty() || !assignBipedJoints(mesh, sourcePositions)) {
+        std::cerr << "Using separate part meshes instead of: " << path << std::endl;
+        mesh = Mesh();
+        return false;
+    }
     mesh.setupMesh();
     return true;
 }
 
-// Draw mesh function
-void drawMesh(Shader& shader, const Mesh& mesh, const glm::mat4& transform) {
-    shader.setMat4("model", transform);
-    shader.setVec3("objectColor", mesh.color);
-    glBindVertexArray(mesh.VAO);
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(mesh.indices.size()), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+// Матрица кости: движение части относительно покоя, перенесённое с точки вращения рига
+// на сустав бипеда (сустав смещается так же, как точка вращения части)
+glm::mat4 bipedJointMatrix(const BipedJointDesc& joint, const glm::mat4& characterBase, const glm::mat4& partTransform) {
+    glm::mat4 delta = glm::inverse(characterBase) * partTransform * glm::inverse(joint.rest);
+    glm::vec3 shift = joint.start - joint.rigPivot;
+    return characterBase * glm::translate(glm::mat4(1.0f), shift) * delta * glm::translate(glm::mat4(1.0f), -shift);
+}
+
+// Поза ходьбы без прыжков, наклонов и ползания - те же формулы, что в главном цикле.
+// Трансформы частей в порядке BipedJoint; phase - фаза цикла ходьбы в радианах.
+// Ею анимируется толпа и по ней снимается атлас импостеров
+void walkPose(const glm::mat4& base, float phase, glm::mat4 parts[BIPED_JOINT_COUNT]) {
+    float walkCycle = std::sin(phase) * 30.0f;
+    float armSwing = std::sin(phase) * 25.0f;
+
+    glm::mat4& torso = parts[static_cast<int>(BipedJoint::Torso)];
+    torso = glm::translate(base, glm::vec3(0.0f, 0.3f, 0.0f));
+    torso = glm::rotate(torso, glm::radians(5.0f), glm::vec3(1, 0, 0));
+    parts[static_cast<int>(BipedJoint::Head)] = glm::translate(torso, glm::vec3(0.0f, 0.2f, 0.0f));
+
+    for (int side = 0; side < 2; side++) {
+        float sign = side == 0 ? -1.0f : 1.0f;     // левая, правая
+        glm::mat4& arm = parts[static_cast<int>(side == 0 ? BipedJoint::LeftArm : BipedJoint::RightArm)];
+        arm = glm::translate(base, glm::vec3(0.25f * sign, 0.7f, 0.0f));
+        arm = glm::rotate(arm, glm::radians(-armSwing * sign), glm::vec3(1, 0, 0));
+        arm = glm::rotate(arm, glm::radians(-10.0f * sign), glm::vec3(0, 0, 1));
+
+        glm::mat4& leg = parts[static_cast<int>(side == 0 ? BipedJoint::LeftLeg : BipedJoint::RightLeg)];
+        leg = glm::translate(base, glm::vec3(0.12f * sign, 0.1f, 0.0f));
+        leg = glm::rotate(leg, glm::radians(walkCycle * sign), glm::vec3(1, 0, 0));
+        leg = glm::translate(leg, glm::vec3(0.0f, -0.3f, 0.0f));
+    }
+}
+
+// Меши персонажа: цельный бипед со скиннингом (если загружен) или шесть частей
+struct CharacterModel {
+    const Mesh* skinned = nullptr;
+    const Mesh* parts[BIPED_JOINT_COUNT] = {};
+    glm::vec3 colors[BIPED_JOINT_COUNT];
+};
+
+// count персонажей с основаниями bases и трансформами частей poses (по BIPED_JOINT_COUNT подряд).
+// Бипед со скиннингом - один instanced-вызов на всех, палитры в арене кадра
+void submitCharacters(RenderQueue& queue, const CharacterModel& model, const glm::mat4* bases, const glm::mat4* poses,
+    int count, float fade, FrameArena& arena) {
+    if (count <= 0) return;
+    if (model.skinned) {
+        glm::mat4* palettes = arena.allocate<glm::mat4>(static_cast<size_t>(count) * BIPED_JOINT_COUNT);
+        for (int i = 0; i < count; i++) {
+            for (int j = 0; j < BIPED_JOINT_COUNT; j++) {
+                palettes[i * BIPED_JOINT_COUNT + j] = bipedJointMatrix(bipedJoints()[j], bases[i], poses[i * BIPED_JOINT_COUNT + j]);
+            }
+        }
+        queue.submitSkinned(*model.skinned, palettes, model.colors, BIPED_JOINT_COUNT, count, fade);
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; j < BIPED_JOINT_COUNT; j++) {
+            queue.submit(*model.parts[j], poses[i * BIPED_JOINT_COUNT + j], model.parts[j]->color, nullptr, fade);
+        }
+    }
 }
 
-// Create a simple floor
-Mesh createFloor() {
-    Mesh floor;
-    floor.color = glm::vec3(0.3f, 0.5f, 0.3f);
+// Толпа для бенчмарка импостеров (--crowd): персонажи идут на месте, каждый со своей фазой
+struct CrowdConfig {
+    int count = 0;
+    float impostorDistance = 20.0f;     // дальше - только импостер
+    float fadeBand = 3.0f;              // ширина полосы перехода перед impostorDistance
+    int maxGeometry = 12;               // сколько ближайших персонажей рисовать геометрией
+};
+
+struct CrowdMember {
+    glm::vec3 position;
+    float yaw;          // градусы
+    float phaseOffset;
+};
 
-    float size = 15.0f; // Увеличили пол
-    floor.vertices = {
-        {glm::vec3(-size, 0.0f, -size), glm::vec3(0.0f, 1.0f, 0.0f)},
-        {glm::vec3(size, 0.0f, -size), glm::vec3(0.0f, 1.0f, 0.0f)},
-        {glm::vec3(-size, 0.0f, size), glm::vec3(0.0f, 1.0f, 0.0f)},
+// Ряды по десять человек, уходящие от камеры
+std::vector<CrowdMember> createCrowd(int count) {
+    std::vector<CrowdMember> crowd;
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> jitter(-0.4f, 0.4f);
+    std::uniform_real_distribution<float> angle(0.0f, 360.0f);
+    for (int i = 0; i < count; i++) {
+        glm::vec3 position((i % 10 - 4.5f) * 2.0f + jitter(random), 0.5f, -4.0f - (i / 10) * 2.5f + jitter(random));
+        crowd.push_back({ position, angle(random), angle(random) * glm::pi<float>() / 180.0f });
+    }
+    return crowd;
+}
+
+// Плитка пола одного чанка в локальных координатах [0, size].
+// GL-буферы не создаются, чтобы функцию можно было вызывать из потока загрузки.
+Mesh createTerrainTile(float size, const glm::vec3& color) {
+    Mesh tile;
+    tile.color = color;
+
+    tile.vertices = {
+        {glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)},
+        {glm::vec3(size, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)},
+        {glm::vec3(0.0f, 0.0f, size), glm::vec3(0.0f, 1.0f, 0.0f)},
         {glm::vec3(size, 0.0f, size), glm::vec3(0.0f, 1.0f, 0.0f)}
     };
 
-    floor.indices = { 0, 1, 2, 2, 1, 3 };
-    floor.setupMesh();
-    return floor;
+    tile.indices = { 0, 2, 1, 1, 2, 3 };
+    return tile;
 }
 
 // Create obstacle meshes
@@ -507,6 +1093,7 @@ Mesh createWallMesh(const glm::vec3& size = glm::vec3(1.0f, 2.0f, 0.2f),
         vertex.position.y *= size.y;
         vertex.position.z *= size.z;
     }
+    wall.setupMesh();
     return wall;
 }
 
@@ -518,12 +1105,547 @@ Mesh createBoxMesh(const glm::vec3& size = glm::vec3(1.0f, 1.0f, 1.0f),
         vertex.position.y *= size.y;
         vertex.position.z *= size.z;
     }
+    box.setupMesh();
     return box;
 }
 
-// Input processing
-void processInput(GLFWwindow* window, CollisionSystem& collisionSystem) {
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+// Препятствие в описании чанка (без GL-ресурсов)
+struct ObstacleDesc {
+    uint32_t mesh;          // индекс в реестре мешей ChunkWorld, 0 - единичный куб
+    ObstacleType type;
+    glm::vec3 position;
+    glm::vec3 scale;
+    glm::vec3 color;
+    BoundingBox bounds;
+};
+
+struct WorldConfig {
+    float chunkSize = 16.0f;
+    int loadRadius = 2;                          // в чанках вокруг персонажа
+    size_t memoryBudget = 4 * 1024;              // байт чанков вне loadRadius, которые держатся на случай возврата
+    int maxUploadsPerFrame = 1;                  // сколько готовых чанков загружать в GPU за кадр
+    int maxObstaclesPerFrame = 256;              // сколько препятствий добавлять в CollisionSystem за кадр
+    unsigned int seed = 1337;
+    bool synchronous = false;                    // ждать запрошенные чанки в том же кадре и загружать все сразу, без лимитов
+};
+
+// Мир из чанков фиксированного размера.
+// Рабочий поток строит CPU-данные чанков (пол и препятствия) вокруг персонажа,
+// главный поток понемногу загружает их в GPU и в CollisionSystem.
+// Чанки за радиусом выгружаются; на одно кольцо дальше держится небольшой LRU-кэш.
+class ChunkWorld {
+public:
+    static const uint32_t CUBE_MESH = 0;
+
+    // Создаёт GL-ресурсы, поэтому конструировать после инициализации контекста
+    explicit ChunkWorld(const WorldConfig& config = WorldConfig()) : config(config) {
+        meshes.push_back(std::make_unique<Mesh>(createCubeMesh(glm::vec3(1.0f))));
+        meshes[CUBE_MESH]->setupMesh();
+        applyGeometryResidency(*meshes[CUBE_MESH]);
+        meshPaths[SCENE_CUBE_MESH] = CUBE_MESH;
+        worker = std::thread(&ChunkWorld::workerLoop, this);
+    }
+
+    ~ChunkWorld() {
+        shutdown();
+    }
+
+    // Препятствие, заданное вручную; попадает в чанк, содержащий его позицию
+    void addStaticObstacle(const ObstacleDesc& obstacle) {
+        std::lock_guard<std::mutex> lock(mutex);
+        staticObstacles[chunkKey(chunkCoord(obstacle.position.x), chunkCoord(obstacle.position.z))].push_back(obstacle);
+    }
+
+    // Массовая загрузка препятствий из .scn: файл отображается в память,
+    // записи раскладываются по чанкам одним проходом
+    bool loadScene(const std::string& path) {
+        auto startTime = std::chrono::steady_clock::now();
+
+        SceneFile scene;
+        if (!scene.open(path)) return false;
+
+        std::vector<uint32_t> meshHandles(scene.meshCount());
+        for (uint32_t i = 0; i < scene.meshCount(); i++) {
+            meshHandles[i] = registerMesh(scene.meshes()[i].path);
+        }
+
+        std::unordered_map<long long, std::vector<ObstacleDesc>> buckets;
+        const SceneObstacleRecord* records = scene.obstacles();
+        for (uint32_t i = 0; i < scene.obstacleCount(); i++) {
+            const SceneObstacleRecord& record = records[i];
+            ObstacleDesc obstacle;
+            obstacle.mesh = meshHandles[record.mesh];
+            obstacle.type = static_cast<ObstacleType>(record.type);
+            obstacle.position = glm::vec3(record.position[0], record.position[1], record.position[2]);
+            obstacle.scale = glm::vec3(record.scale[0], record.scale[1], record.scale[2]);
+            obstacle.color = glm::vec3(record.color[0], record.color[1], record.color[2]);
+            obstacle.bounds = BoundingBox(glm::vec3(record.boundsMin[0], record.boundsMin[1], record.boundsMin[2]),
+                glm::vec3(record.boundsMax[0], record.boundsMax[1], record.boundsMax[2]));
+            buckets[chunkKey(chunkCoord(obstacle.position.x), chunkCoord(obstacle.position.z))].push_back(obstacle);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto& bucket : buckets) {
+                auto& target = staticObstacles[bucket.first];
+                if (target.empty()) target = std::move(bucket.second);
+                else target.insert(target.end(), bucket.second.begin(), bucket.second.end());
+            }
+        }
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+        std::cout << "Scene " << path << ": " << scene.obstacleCount() << " obstacles in "
+            << buckets.size() << " chunks, loaded in " << ms << " ms" << std::endl;
+        return true;
+    }
+
+    void update(const glm::vec3& center, CollisionSystem& collisionSystem) {
+        int centerX = chunkCoord(center.x);
+        int centerZ = chunkCoord(center.z);
+        centerChunkX = centerX;
+        centerChunkZ = centerZ;
+
+        // Запросить недостающие чанки, ближние первыми
+        std::vector<std::pair<int, long long>> wanted;
+        for (int dz = -config.loadRadius; dz <= config.loadRadius; dz++) {
+            for (int dx = -config.loadRadius; dx <= config.loadRadius; dx++) {
+                int distance2 = dx * dx + dz * dz;
+                if (distance2 > config.loadRadius * config.loadRadius) continue;
+
+                long long key = chunkKey(centerX + dx, centerZ + dz);
+                auto loaded = chunks.find(key);
+                if (loaded != chunks.end()) {
+                    lru.splice(lru.begin(), lru, loaded->second.lruPosition);
+                }
+                else if (!pending.count(key)) {
+                    wanted.push_back({ distance2, key });
+                }
+            }
+        }
+        std::sort(wanted.begin(), wanted.end());
+        if (!wanted.empty()) {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const auto& request : wanted) {
+                requests.push_back(request.second);
+                pending.insert(request.second);
+            }
+            wakeWorker.notify_one();
+        }
+
+        // Забрать готовые чанки, не больше maxUploadsPerFrame за кадр.
+        // В синхронном режиме кадр ждёт все запрошенные: набор чанков не зависит от скорости потока
+        int uploadLimit = config.maxUploadsPerFrame;
+        if (config.synchronous) {
+            std::unique_lock<std::mutex> lock(mutex);
+            chunkReady.wait(lock, [this] { return completed.size() >= pending.size(); });
+            uploadLimit = static_cast<int>(completed.size());
+        }
+        for (int uploads = 0; uploads < uploadLimit; uploads++) {
+            ChunkData data;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (completed.empty()) break;
+                data = std::move(completed.front());
+                completed.pop_front();
+            }
+            pending.erase(data.key);
+
+            int dx = data.x - centerX;
+            int dz = data.z - centerZ;
+            if (dx * dx + dz * dz > (config.loadRadius + 1) * (config.loadRadius + 1)) {
+                continue; // персонаж ушёл, пока чанк строился
+            }
+            activate(std::move(data));
+        }
+
+        // Препятствия плотных чанков добавляются по частям, чтобы кадр не замирал
+        registerObstacles(collisionSystem, config.synchronous ? std::numeric_limits<int>::max() : config.maxObstaclesPerFrame);
+        evictOutsideRadius(centerX, centerZ, collisionSystem);
+    }
+
+    // Пол чанков в радиусе загрузки, попавших в пирамиду видимости; кэш за радиусом не рисуется
+    void draw(RenderQueue& queue, const Frustum& frustum) const {
+        for (const auto& entry : chunks) {
+            const Chunk& chunk = entry.second;
+            if (chunkDistance2(chunk, centerChunkX, centerChunkZ) > config.loadRadius * config.loadRadius) continue;
+            BoundingBox bounds(chunk.origin, chunk.origin + glm::vec3(config.chunkSize, 0.0f, config.chunkSize));
+            if (!frustum.intersects(bounds)) continue;
+            queue.submit(chunk.terrain, glm::translate(glm::mat4(1.0f), chunk.origin));
+        }
+    }
+
+    size_t loadedChunkCount() const { return chunks.size(); }
+    // Все запрошенные чанки загружены и их препятствия добавлены: после update() без новых запросов
+    bool isSettled() const { return pending.empty() && activating.empty(); }
+    size_t residentBytes() const { return memoryUsed; }
+
+    // Останавливает поток и освобождает GL-ресурсы; вызывать до glfwTerminate
+    void shutdown(CollisionSystem* collisionSystem = nullptr) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeWorker.notify_all();
+        if (worker.joinable()) worker.join();
+
+        if (collisionSystem) {
+            for (auto& entry : chunks) {
+                for (ObstacleId id : entry.second.obstacleIds) collisionSystem->removeObstacle(id);
+            }
+        }
+        chunks.clear();
+        lru.clear();
+        memoryUsed = 0;
+        meshes.clear();
+    }
+
+private:
+    struct ChunkData {
+        long long key = 0;
+        int x = 0;
+        int z = 0;
+        Mesh terrain;
+        std::vector<ObstacleDesc> obstacles;
+    };
+
+    struct Chunk {
+        glm::vec3 origin;
+        Mesh terrain;
+        std::vector<ObstacleId> obstacleIds;
+        std::vector<ObstacleDesc> waitingObstacles;     // ещё не добавлены в CollisionSystem
+        size_t nextObstacle = 0;
+        size_t memoryBytes = 0;
+        std::list<long long>::iterator lruPosition;
+    };
+
+    WorldConfig config;
+
+    // Реестр общих мешей препятствий; указатели стабильны, на них ссылаются CollisionMesh
+    std::vector<std::unique_ptr<Mesh>> meshes;
+    std::unordered_map<std::string, uint32_t> meshPaths;
+
+    // Состояние главного потока
+    std::unordered_map<long long, Chunk> chunks;
+    std::list<long long> lru;                 // спереди - недавно использованные
+    std::unordered_set<long long> pending;    // запрошены, но ещё не загружены
+    std::deque<long long> activating;         // загружены, но добавлены не все препятствия
+    int centerChunkX = 0;                     // чанк персонажа на последнем update()
+    int centerChunkZ = 0;
+    size_t memoryUsed = 0;
+
+    // Общее с рабочим потоком, под mutex
+    std::mutex mutex;
+    std::condition_variable wakeWorker;
+    std::condition_variable chunkReady;
+    std::deque<long long> requests;
+    std::deque<ChunkData> completed;
+    std::unordered_map<long long, std::vector<ObstacleDesc>> staticObstacles;
+    bool stopping = false;
+    std::thread worker;
+
+    uint32_t registerMesh(const std::string& path) {
+        auto found = meshPaths.find(path);
+        if (found != meshPaths.end()) return found->second;
+
+        auto mesh = std::make_unique<Mesh>();
+        if (!loadOBJ(path, *mesh, glm::vec3(1.0f))) return CUBE_MESH;
+        generateLods(*mesh, path);
+        applyGeometryResidency(*mesh);
+        uint32_t handle = static_cast<uint32_t>(meshes.size());
+        meshes.push_back(std::move(mesh));
+        meshPaths[path] = handle;
+        return handle;
+    }
+
+    int chunkCoord(float world) const {
+        return static_cast<int>(std::floor(world / config.chunkSize));
+    }
+
+    // Квадрат расстояния в чанках от чанка до (centerX, centerZ)
+    int chunkDistance2(const Chunk& chunk, int centerX, int centerZ) const {
+        int dx = chunkCoord(chunk.origin.x + 0.5f * config.chunkSize) - centerX;
+        int dz = chunkCoord(chunk.origin.z + 0.5f * config.chunkSize) - centerZ;
+        return dx * dx + dz * dz;
+    }
+
+    static long long chunkKey(int x, int z) {
+        // Сдвиг в беззнаковом: сдвиг отрицательного x влево - неопределённое поведение
+        uint64_t bits = (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(z);
+        return static_cast<long long>(bits);
+    }
+
+    void workerLoop() {
+        for (;;) {
+            long long key;
+            std::vector<ObstacleDesc> authored;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeWorker.wait(lock, [this] { return stopping || !requests.empty(); });
+                if (stopping) return;
+                key = requests.front();
+                requests.pop_front();
+                auto found = staticObstacles.find(key);
+                if (found != staticObstacles.end()) authored = found->second;
+            }
+
+            ChunkData data = generateChunk(key, authored);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                completed.push_back(std::move(data));
+            }
+            chunkReady.notify_one();
+        }
+    }
+
+    // Детерминированная генерация: одинаковые координаты дают одинаковый чанк
+    ChunkData generateChunk(long long key, const std::vector<ObstacleDesc>& authored) const {
+        ChunkData data;
+        data.key = key;
+        uint64_t bits = static_cast<uint64_t>(key);
+        data.x = static_cast<int>(static_cast<uint32_t>(bits >> 32));
+        data.z = static_cast<int>(static_cast<uint32_t>(bits));
+
+        bool checker = ((data.x + data.z) & 1) != 0;
+        data.terrain = createTerrainTile(config.chunkSize,
+            checker ? glm::vec3(0.3f, 0.5f, 0.3f) : glm::vec3(0.27f, 0.46f, 0.27f));
+
+        data.obstacles = authored;
+
+        std::mt19937 rng(config.seed ^ static_cast<unsigned int>(data.x * 73856093) ^ static_cast<unsigned int>(data.z * 19349663));
+        std::uniform_int_distribution<int> countDist(0, 3);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        glm::vec3 origin(data.x * config.chunkSize, 0.0f, data.z * config.chunkSize);
+        int count = countDist(rng);
+        for (int i = 0; i < count; i++) {
+            glm::vec3 size(0.6f + unit(rng) * 1.6f, 0.5f + unit(rng) * 1.5f, 0.6f + unit(rng) * 1.6f);
+            glm::vec3 position = origin + glm::vec3(unit(rng) * config.chunkSize, size.y * 0.5f, unit(rng) * config.chunkSize);
+
+            // Точка появления персонажа остаётся свободной
+            if (std::abs(position.x) < 4.0f && std::abs(position.z) < 4.0f) continue;
+
+            ObstacleDesc obstacle;
+            obstacle.mesh = CUBE_MESH;
+            obstacle.type = ObstacleType::Box;
+            obstacle.position = position;
+            obstacle.scale = size;
+            obstacle.color = glm::vec3(0.4f + unit(rng) * 0.4f, 0.3f + unit(rng) * 0.3f, 0.2f + unit(rng) * 0.3f);
+            obstacle.bounds = BoundingBox(-size * 0.5f, size * 0.5f);
+            data.obstacles.push_back(obstacle);
+        }
+        return data;
+    }
+
+    void activate(ChunkData&& data) {
+        Chunk chunk;
+        chunk.origin = glm::vec3(data.x * config.chunkSize, 0.0f, data.z * config.chunkSize);
+        chunk.terrain = std::move(data.terrain);
+        chunk.terrain.setupMesh();
+        applyGeometryResidency(chunk.terrain);
+        chunk.memoryBytes = chunk.terrain.memoryBytes();
+
+        chunk.memoryBytes += data.obstacles.size() * sizeof(CollisionMesh);
+        chunk.obstacleIds.reserve(data.obstacles.size());
+        chunk.waitingObstacles = std::move(data.obstacles);
+        if (!chunk.waitingObstacles.empty()) activating.push_back(data.key);
+
+        memoryUsed += chunk.memoryBytes;
+        lru.push_front(data.key);
+        chunk.lruPosition = lru.begin();
+        chunks.emplace(data.key, std::move(chunk));
+    }
+
+    // Добавляет в CollisionSystem не больше limit препятствий, по чанкам в порядке загрузки.
+    // Выгруженные тем временем чанки пропускаются
+    void registerObstacles(CollisionSystem& collisionSystem, int limit) {
+        while (limit > 0 && !activating.empty()) {
+            auto found = chunks.find(activating.front());
+            if (found == chunks.end() || found->second.nextObstacle >= found->second.waitingObstacles.size()) {
+                activating.pop_front();
+                continue;
+            }
+
+            Chunk& chunk = found->second;
+            size_t end = std::min(chunk.waitingObstacles.size(), chunk.nextObstacle + static_cast<size_t>(limit));
+            limit -= static_cast<int>(end - chunk.nextObstacle);
+            for (; chunk.nextObstacle < end; chunk.nextObstacle++) {
+                const ObstacleDesc& obstacle = chunk.waitingObstacles[chunk.nextObstacle];
+                chunk.obstacleIds.push_back(collisionSystem.addObstacle(CollisionMesh(meshes[obstacle.mesh].get(),
+                    obstacle.scale, obstacle.color, obstacle.bounds, obstacle.position, obstacle.type)));
+            }
+            if (chunk.nextObstacle == chunk.waitingObstacles.size()) {
+                chunk.waitingObstacles = std::vector<ObstacleDesc>();
+                chunk.nextObstacle = 0;
+                activating.pop_front();
+            }
+        }
+    }
+
+    // Чанки в loadRadius остаются всегда, дальше loadRadius + 1 - выгружаются сразу.
+    // Между ними держится кэш на случай возврата, не больше memoryBudget байт:
+    // LRU идёт от недавно использованных, так что вытесняются давние
+    void evictOutsideRadius(int centerX, int centerZ, CollisionSystem& collisionSystem) {
+        int keepRadius = config.loadRadius + 1;
+        size_t cachedBytes = 0;
+        for (auto position = lru.begin(); position != lru.end();) {
+            long long key = *position;
+            Chunk& chunk = chunks.at(key);
+            int distance2 = chunkDistance2(chunk, centerX, centerZ);
+            if (distance2 <= config.loadRadius * config.loadRadius) {
+                ++position;
+                continue;
+            }
+            if (distance2 <= keepRadius * keepRadius && cachedBytes + chunk.memoryBytes <= config.memoryBudget) {
+                cachedBytes += chunk.memoryBytes;
+                ++position;
+                continue;
+            }
+
+            for (ObstacleId id : chunk.obstacleIds) collisionSystem.removeObstacle(id);
+            memoryUsed -= chunk.memoryBytes;
+            position = lru.erase(position);
+            chunks.erase(key);
+        }
+    }
+};
+
+// Сцена для бенчмарка освещения: точечные источники кружат вокруг случайных точек
+struct BenchmarkLight {
+    glm::vec3 anchor;
+    float orbit;
+    float speed;
+    float phase;
+};
+
+std::vector<BenchmarkLight> createBenchmarkLights(int count, unsigned int seed = 7) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    std::vector<BenchmarkLight> lights(count);
+    for (auto& light : lights) {
+        float angle = unit(rng) * glm::two_pi<float>();
+        float distance = std::sqrt(unit(rng)) * 25.0f;
+        light.anchor = glm::vec3(std::cos(angle) * distance, 0.3f + unit(rng) * 2.2f, std::sin(angle) * distance);
+        light.orbit = 0.5f + unit(rng) * 2.0f;
+        light.speed = 0.3f + unit(rng) * 1.2f;
+        light.phase = unit(rng) * glm::two_pi<float>();
+    }
+    return lights;
+}
+
+void updateBenchmarkLights(const std::vector<BenchmarkLight>& benchmark, std::vector<PointLight>& lights, float time) {
+    lights.resize(benchmark.size());
+    for (size_t i = 0; i < benchmark.size(); i++) {
+        const BenchmarkLight& source = benchmark[i];
+        float angle = time * source.speed + source.phase;
+        PointLight& light = lights[i];
+        light.position = source.anchor + glm::vec3(std::cos(angle), 0.0f, std::sin(angle)) * source.orbit;
+        light.radius = 2.5f + 2.0f * std::fmod(source.phase, 1.0f);
+        // Цвет из фазы, чтобы источники различались
+        light.color = glm::vec3(0.5f + 0.5f * std::cos(source.phase),
+            0.5f + 0.5f * std::cos(source.phase + 2.094f),
+            0.5f + 0.5f * std::cos(source.phase + 4.188f));
+        light.intensity = 2.0f;
+    }
+}
+
+// Колбэк клавиатуры в потоке окна: только метка времени и запись в очередь
+void keyCallback(GLFWwindow* window, int key, int /*scancode*/, int action, int /*mods*/) {
+    if (action == GLFW_REPEAT) return;
+    auto* queue = static_cast<InputQueue*>(glfwGetWindowUserPointer(window));
+    queue->push({ glfwGetTime(), key, action == GLFW_PRESS });
+}
+
+// Задержка от ввода до кадра: от самого раннего нажатия, учтённого в кадре, до момента,
+// когда поток кадра видит fence после SwapBuffers этого кадра сигнальным. Вывод на
+// монитор сюда не входит, так что это нижняя оценка задержки до фотонов.
+class InputLatency {
+public:
+    void notePress(double eventTime) {
+        if (pendingInput < 0.0 || eventTime < pendingInput) pendingInput = eventTime;
+    }
+
+    // После SwapBuffers: кадр с учтёнными нажатиями отправлен
+    void frameSubmitted() {
+        poll();
+        if (pendingInput < 0.0) return;
+        if (inFlightCount == MAX_IN_FLIGHT) return;     // кадры копятся быстрее, чем их видно - пропустить замер
+        InFlight& slot = inFlight[(inFlightHead + inFlightCount) % MAX_IN_FLIGHT];
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.inputTime = pendingInput;
+        inFlightCount++;
+        glFlush();
+        pendingInput = -1.0;
+    }
+
+    // Проверяет отправленные кадры без ожидания
+    void poll() {
+        while (inFlightCount > 0) {
+            InFlight& slot = inFlight[inFlightHead];
+            GLenum result = glClientWaitSync(slot.fence, 0, 0);
+            if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) break;
+            double milliseconds = (glfwGetTime() - slot.inputTime) * 1000.0;
+            glDeleteSync(slot.fence);
+            inFlightHead = (inFlightHead + 1) % MAX_IN_FLIGHT;
+            inFlightCount--;
+
+            sampleCount++;
+            totalMs += milliseconds;
+            maxMs = std::max(maxMs, milliseconds);
+        }
+    }
+
+    // Одна строка за период; частота кадров рядом, чтобы видно было поведение под нагрузкой
+    void report(double periodSeconds, int frames, uint32_t droppedEvents) {
+        std::cout << "Input latency: " << sampleCount << " frames with input, avg "
+            << (sampleCount > 0 ? totalMs / sampleCount : 0.0) << " ms, max " << maxMs << " ms at "
+            << frames / periodSeconds << " fps, " << droppedEvents << " events dropped" << std::endl;
+        sampleCount = 0;
+        totalMs = maxMs = 0.0;
+    }
+
+    void destroy() {
+        for (; inFlightCount > 0; inFlightCount--) {
+            glDeleteSync(inFlight[inFlightHead].fence);
+            inFlightHead = (inFlightHead + 1) % MAX_IN_FLIGHT;
+        }
+    }
+
+private:
+    static const int MAX_IN_FLIGHT = 8;
+
+    struct InFlight {
+        GLsync fence;
+        double inputTime;
+    };
+
+    InFlight inFlight[MAX_IN_FLIGHT] = {};
+    int inFlightHead = 0;
+    int inFlightCount = 0;
+    double pendingInput = -1.0;
+    int sampleCount = 0;
+    double totalMs = 0.0;
+    double maxMs = 0.0;
+};
+
+// Переносит в шаг [stepStart, stepEnd] события, пришедшие до его конца; более поздние
+// остаются в очереди до следующего шага
+void consumeInput(InputQueue& queue, InputTimeline& input, InputLatency& latency, double stepStart, double stepEnd) {
+    input.beginStep(stepStart, stepEnd);
+    InputEvent event;
+    while (queue.peek(event) && event.time <= stepEnd) {
+        input.apply(event);
+        if (event.pressed) latency.notePress(event.time);
+        queue.pop();
+    }
+    input.endStep();
+}
+
+// Input processing: движение и прыжок считаются по времени удержания клавиш внутри шага,
+// поэтому короткое нажатие не теряется и результат не зависит от частоты кадров
+void processInput(GLFWwindow* window, const InputTimeline& input, CollisionSystem& collisionSystem) {
+    if (input.wasActive(GLFW_KEY_ESCAPE))
         glfwSetWindowShouldClose(window, true);
 
     // Сохраняем старую позицию для разрешения коллизий
@@ -535,15 +1657,15 @@ void processInput(GLFWwindow* window, CollisionSystem& collisionSystem) {
 
     // Ползание (C) - теперь просто наклон вперед
     bool wasCrawling = isCrawling;
-    isCrawling = glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS;
+    isCrawling = input.isDown(GLFW_KEY_C);
 
     // Бег (Z)
     bool wasRunning = isRunning;
-    isRunning = glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS;
+    isRunning = input.isDown(GLFW_KEY_Z);
 
     // Наклоны (Q/E)
-    isLeaningLeft = glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS;
-    isLeaningRight = glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS;
+    isLeaningLeft = input.isDown(GLFW_KEY_Q);
+    isLeaningRight = input.isDown(GLFW_KEY_E);
 
     // Character movement (arrow keys)
     glm::vec3 characterForward(std::sin(glm::radians(characterYaw)), 0, std::cos(glm::radians(characterYaw)));
@@ -551,22 +1673,21 @@ void processInput(GLFWwindow* window, CollisionSystem& collisionSystem) {
 
     // Выбор скорости в зависимости от состояния
     float currentSpeed = isCrawling ? crawlSpeed : (isRunning ? runSpeed : movementSpeed);
-    float characterSpeed = currentSpeed * deltaTime;
 
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
-        characterPos += characterForward * characterSpeed;
+    if (input.wasActive(GLFW_KEY_W)) {
+        characterPos += characterForward * currentSpeed * input.heldTime(GLFW_KEY_W);
         isMoving = true;
     }
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
-        characterPos -= characterForward * characterSpeed;
+    if (input.wasActive(GLFW_KEY_S)) {
+        characterPos -= characterForward * currentSpeed * input.heldTime(GLFW_KEY_S);
         isMoving = true;
     }
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
-        characterYaw += 90.0f * deltaTime;
+    if (input.wasActive(GLFW_KEY_A)) {
+        characterYaw += 90.0f * input.heldTime(GLFW_KEY_A);
         isMoving = true;
     }
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
-        characterYaw -= 90.0f * deltaTime;
+    if (input.wasActive(GLFW_KEY_D)) {
+        characterYaw -= 90.0f * input.heldTime(GLFW_KEY_D);
         isMoving = true;
     }
 
@@ -590,84 +1711,268 @@ void processInput(GLFWwindow* window, CollisionSystem& collisionSystem) {
     else if (isLeaningRight) targetLean = -15.0f;
     leanBlend = glm::mix(leanBlend, targetLean, deltaTime * 6.0f);
 
-    // Улучшенный прыжок (нельзя прыгать во время ползания)
-    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS && !isCrawling) {
+    // Улучшенный прыжок (нельзя прыгать во время ползания).
+    // Прыжок начинается в момент нажатия, удержание копится с точностью до событий
+    if (input.wasActive(GLFW_KEY_SPACE) && !isCrawling) {
         if (!isJumping && !isLanding) {
             isJumping = true;
-            jumpHoldTime = 0.0f;
-            jumpVelocity = baseJumpForce;
+            jumpHoldTime = input.heldTime(GLFW_KEY_SPACE);
+            jumpVelocity = glm::min(baseJumpForce + jumpHoldTime * 15.0f, maxJumpForce);
             jumpAnimationTime = 0.0f;
+            jumpStepTime = static_cast<float>(input.end() - input.activeSince(GLFW_KEY_SPACE));
         }
         else if (isJumping && jumpVelocity > 0.0f) {
-            jumpHoldTime += deltaTime;
+            jumpHoldTime += input.heldTime(GLFW_KEY_SPACE);
             float jumpPower = glm::min(baseJumpForce + jumpHoldTime * 15.0f, maxJumpForce);
             jumpVelocity = jumpPower;
         }
     }
-    else if (isJumping && jumpHoldTime == 0.0f) {
-        jumpVelocity = baseJumpForce;
-    }
 }
 
-int main() {
-    if (!glfwInit()) {
-        std::cerr << "Failed to initialize GLFW\n";
+int main(int argc, char** argv) {
+    // Аргументы командной строки:
+    //   --convert-scene <scene.txt> <scene.scn>  - собрать бинарную сцену и выйти
+    //   --scene <scene.scn>                      - загрузить препятствия из бинарной сцены
+    //   --lights <count>                         - бенчмарк освещения с заданным числом точечных источников
+    //   --frame-budget <ms>                      - бюджет кадра для динамического разрешения (0 - выключить)
+    //   --headless <frames>                      - без окна: отрисовать заданное число кадров в файлы
+    //   --capture-dir <dir>, --capture-format <png|raw> - куда и в каком виде писать кадры (frames, png)
+    //   --crowd <count>                          - толпа для бенчмарка импостеров
+    //   --impostor-distance <m>                  - с какого расстояния персонажи толпы рисуются импостерами (20)
+    std::string scenePath;
+    int benchmarkLightCount = 0;
+    float frameBudgetMs = 1000.0f / 60.0f;
+    int headlessFrames = 0;
+    std::string captureDirectory = "frames";
+    FrameCapture::Format captureFormat = FrameCapture::Format::Png;
+    CrowdConfig crowdConfig;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--convert-scene" && i + 2 < argc) {
+            return convertSceneText(argv[i + 1], argv[i + 2]) ? 0 : -1;
+        }
+        else if (arg == "--scene" && i + 1 < argc) {
+            scenePath = argv[++i];
+        }
+        else if (arg == "--lights" && i + 1 < argc) {
+            benchmarkLightCount = std::max(0, std::atoi(argv[++i]));
+        }
+        else if (arg == "--frame-budget" && i + 1 < argc) {
+            frameBudgetMs = std::max(0.0f, static_cast<float>(std::atof(argv[++i])));
+        }
+        else if (arg == "--headless" && i + 1 < argc) {
+            headlessFrames = std::max(0, std::atoi(argv[++i]));
+        }
+        else if (arg == "--capture-dir" && i + 1 < argc) {
+            captureDirectory = argv[++i];
+        }
+        else if (arg == "--capture-format" && i + 1 < argc && (std::string(argv[i + 1]) == "png" || std::string(argv[i + 1]) == "raw")) {
+            captureFormat = std::string(argv[++i]) == "png" ? FrameCapture::Format::Png : FrameCapture::Format::Raw;
+        }
+        else if (arg == "--crowd" && i + 1 < argc) {
+            crowdConfig.count = std::max(0, std::atoi(argv[++i]));
+        }
+        else if (arg == "--impostor-distance" && i + 1 < argc) {
+            crowdConfig.impostorDistance = std::max(0.0f, static_cast<float>(std::atof(argv[++i])));
+        }
+        else {
+            std::cerr << "Unknown argument: " << arg << "\n"
+                << "Usage: " << argv[0] << " [--scene <file.scn>] [--lights <count>] [--frame-budget <ms>]\n"
+                << "       [--crowd <count> [--impostor-distance <m>]]\n"
+                << "       [--headless <frames> [--capture-dir <dir>] [--capture-format png|raw]] | --convert-scene <in.txt> <out.scn>\n";
+            return -1;
+        }
+    }
+
+    // Без окна: контекст EGL surfaceless, кадры рисуются в FBO и пишутся в файлы
+    bool headless = headlessFrames > 0;
+    GLFWwindow* window = nullptr;
+    Shader::LoadProc loadProc = nullptr;
+    // Нажатия клавиш из потока окна в поток кадра
+    InputQueue inputQueue;
+#ifdef ENABLE_HEADLESS
+    HeadlessContext headlessContext;
+#endif
+    if (headless) {
+#ifdef ENABLE_HEADLESS
+        if (!headlessContext.create()) {
+            std::cerr << "Failed to create headless context\n";
+            return -1;
+        }
+        loadProc = HeadlessContext::getProcAddress;
+#else
+        std::cerr << "Headless mode needs a build with -DENABLE_HEADLESS (links libEGL)\n";
         return -1;
+#endif
     }
+    else {
+        if (!glfwInit()) {
+            std::cerr << "Failed to initialize GLFW\n";
+            return -1;
+        }
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "3D Character Animation by Adilzhan Kurmet and Adilet Malikov", NULL, NULL);
-    if (!window) {
-        std::cerr << "Failed to create GLFW window\n";
-        glfwTerminate();
-        return -1;
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "3D Character Animation by Adilzhan Kurmet and Adilet Malikov", NULL, NULL);
+        if (!window) {
+            std::cerr << "Failed to create GLFW window\n";
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(window);
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+        glfwSetWindowUserPointer(window, &inputQueue);
+        glfwSetKeyCallback(window, keyCallback);
+        loadProc = (Shader::LoadProc)glfwGetProcAddress;
     }
-    glfwMakeContextCurrent(window);
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
 
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    if (!gladLoadGLLoader((GLADloadproc)loadProc)) {
         std::cerr << "Failed to initialize GLAD\n";
         return -1;
     }
 
     glEnable(GL_DEPTH_TEST);
 
+    Shader::enableBinaryCache("shader_cache", loadProc);
+
     Shader shader;
     if (!shader.load("shaders/vertex.glsl", "shaders/fragment.glsl")) {
         std::cerr << "Failed to load shaders\n";
         return -1;
     }
 
+    RenderQueue renderQueue;
+    if (!renderQueue.init(shader, loadProc)) {
+        std::cerr << "Failed to create render queue\n";
+        return -1;
+    }
+
+    ThreadPool threadPool;
+    ClusteredLights clusteredLights;
+    clusteredLights.init();
+
+    // Записываемые кадры должны быть одного размера, поэтому без окна масштаб не меняется
+    DynamicResolution dynamicResolution;
+    dynamicResolution.init(SCR_WIDTH, SCR_HEIGHT, headless ? 0.0f : frameBudgetMs);
+
+    FrameCapture frameCapture;
+    if (headless) {
+        std::error_code error;
+        std::filesystem::create_directories(captureDirectory, error);
+        if (!frameCapture.init(SCR_WIDTH, SCR_HEIGHT, captureDirectory, captureFormat)) {
+            std::cerr << "Failed to set up frame capture\n";
+            return -1;
+        }
+    }
+    std::vector<BenchmarkLight> benchmarkLights = createBenchmarkLights(benchmarkLightCount);
+    std::vector<PointLight> pointLights;
+    if (benchmarkLightCount > 0) {
+        std::cout << "Light benchmark: " << benchmarkLightCount << " point lights, "
+            << threadPool.threadCount() << " assignment thread(s)" << std::endl;
+    }
+
     // Load character parts
     Mesh torso, head, leftArm, rightArm, leftLeg, rightLeg;
 
-    loadOBJ("models/torso.obj", torso, glm::vec3(0.8f, 0.2f, 0.2f));
-    loadOBJ("models/head.obj", head, glm::vec3(0.9f, 0.8f, 0.7f));
-    loadOBJ("models/left_arm.obj", leftArm, glm::vec3(0.2f, 0.4f, 0.8f));
-    loadOBJ("models/right_arm.obj", rightArm, glm::vec3(0.2f, 0.4f, 0.8f));
-    loadOBJ("models/left_leg.obj", leftLeg, glm::vec3(0.3f, 0.3f, 0.3f));
-    loadOBJ("models/right_leg.obj", rightLeg, glm::vec3(0.3f, 0.3f, 0.3f));
+    const glm::vec3 armColor(0.2f, 0.4f, 0.8f);
+    const glm::vec3 legColor(0.3f, 0.3f, 0.3f);
+    loadOBJ("models/torso.obj", torso, glm::vec3(0.8f, 0.2f, 0.2f), createTorsoMesh);
+    loadOBJ("models/head.obj", head, glm::vec3(0.9f, 0.8f, 0.7f), createHeadMesh);
+    loadOBJ("models/left_arm.obj", leftArm, armColor, [&] { return createArmMesh(true, armColor); });
+    loadOBJ("models/right_arm.obj", rightArm, armColor, [&] { return createArmMesh(false, armColor); });
+    loadOBJ("models/left_leg.obj", leftLeg, legColor, [&] { return createLegMesh(true, legColor); });
+    loadOBJ("models/right_leg.obj", rightLeg, legColor, [&] { return createLegMesh(false, legColor); });
+
+    generateLods(torso, "torso");
+    generateLods(head, "head");
+    generateLods(leftArm, "left_arm");
+    generateLods(rightArm, "right_arm");
+    generateLods(leftLeg, "left_leg");
+    generateLods(rightLeg, "right_leg");
+    for (Mesh* part : { &torso, &head, &leftArm, &rightArm, &leftLeg, &rightLeg }) {
+        applyGeometryResidency(*part);
+    }
+    LodSelection torsoLod, headLod, leftArmLod, rightArmLod, leftLegLod, rightLegLod;
+
+    // Цельный бипед со скиннингом; без biped.obj персонаж рисуется по частям
+    Mesh biped;
+    bool skinnedBiped = loadSkinnedBiped("models/biped.obj", biped);
+    applyGeometryResidency(biped);
+    const glm::vec3 bipedColors[BIPED_JOINT_COUNT] = { torso.color, head.color, armColor, armColor, legColor, legColor };
+
+    CharacterModel characterModel;
+    characterModel.skinned = skinnedBiped ? &biped : nullptr;
+    const Mesh* characterParts[BIPED_JOINT_COUNT] = { &torso, &head, &leftArm, &rightArm, &leftLeg, &rightLeg };
+    for (int j = 0; j < BIPED_JOINT_COUNT; j++) {
+        characterModel.parts[j] = characterParts[j];
+        characterModel.colors[j] = bipedColors[j];
+    }
 
-    Mesh floor = createFloor();
+    // Толпа; дальние её персонажи рисуются импостерами из атласа, снятого с этих же мешей
+    std::vector<CrowdMember> crowd = createCrowd(crowdConfig.count);
+    ImpostorAtlas impostors;
+    // Рамка персонажа относительно основания: ограничивающие сферы частей во всех снимаемых позах.
+    // По ней отсекается толпа и кадрируется атлас
+    const glm::mat4 origin(1.0f);
+    float halfWidth = 0.0f, bottom = std::numeric_limits<float>::max(), top = -bottom;
+    glm::mat4 pose[BIPED_JOINT_COUNT];
+    for (int p = 0; p < ImpostorAtlas::POSE_COUNT; p++) {
+        walkPose(origin, p * glm::two_pi<float>() / ImpostorAtlas::POSE_COUNT, pose);
+        for (int j = 0; j < BIPED_JOINT_COUNT; j++) {
+            glm::vec3 center = glm::vec3(pose[j] * glm::vec4(characterParts[j]->boundsCenter, 1.0f));
+            float radius = characterParts[j]->boundsRadius * 1.05f;
+            halfWidth = std::max(halfWidth, glm::length(glm::vec2(center.x, center.z)) + radius);
+            bottom = std::min(bottom, center.y - radius);
+            top = std::max(top, center.y + radius);
+        }
+    }
+    const BoundingBox crowdMemberBounds(glm::vec3(-halfWidth, bottom, -halfWidth), glm::vec3(halfWidth, top, halfWidth));
+
+    if (!crowd.empty()) {
+        Shader bakeShader;
+        RenderQueue bakeQueue;
+        bool baked = false;
+        if (impostors.init(loadProc, static_cast<int>(crowd.size()))
+            && bakeShader.load("shaders/vertex.glsl", "shaders/fragment.glsl", { "IMPOSTOR_BAKE" })
+            && bakeQueue.init(bakeShader, loadProc)) {
+            FrameArena bakeArena;
+            baked = impostors.bake(bakeShader, halfWidth, bottom, top, [&](int p) {
+                walkPose(origin, p * glm::two_pi<float>() / ImpostorAtlas::POSE_COUNT, pose);
+                bakeArena.reset();
+                bakeQueue.begin(bakeArena);
+                submitCharacters(bakeQueue, characterModel, &origin, pose, 1, 1.0f, bakeArena);
+                bakeQueue.flush();
+            });
+        }
+        bakeQueue.destroy();
+        if (!baked) {
+            std::cerr << "Impostors unavailable, the crowd is drawn as geometry\n";
+            impostors.destroy();
+        }
+        std::cout << "Crowd: " << crowd.size() << " characters, impostors from " << crowdConfig.impostorDistance << " m" << std::endl;
+    }
 
-    // Создаём систему коллизий и добавляем ПРОСТЫЕ препятствия
     CollisionSystem collisionSystem;
 
-    // Всего 4 простых препятствия
-    Mesh wallMesh = createWallMesh(glm::vec3(8.0f, 2.0f, 0.3f), glm::vec3(0.5f, 0.3f, 0.1f));
-    BoundingBox wallBounds(glm::vec3(-4.0f, 0.0f, -0.15f), glm::vec3(4.0f, 2.0f, 0.15f));
-    collisionSystem.addObstacle(CollisionMesh(wallMesh, wallBounds, glm::vec3(0.0f, 1.0f, 5.0f)));
-
-    Mesh boxMesh = createBoxMesh(glm::vec3(1.5f, 1.0f, 1.5f), glm::vec3(0.8f, 0.6f, 0.2f));
-    BoundingBox boxBounds(glm::vec3(-0.75f, 0.0f, -0.75f), glm::vec3(0.75f, 1.0f, 0.75f));
-    collisionSystem.addObstacle(CollisionMesh(boxMesh, boxBounds, glm::vec3(3.0f, 0.5f, -3.0f)));
-
-    Mesh boxMesh2 = createBoxMesh(glm::vec3(1.0f, 0.8f, 1.0f), glm::vec3(0.4f, 0.2f, 0.8f));
-    BoundingBox boxBounds2(glm::vec3(-0.5f, 0.0f, -0.5f), glm::vec3(0.5f, 0.8f, 0.5f));
-    collisionSystem.addObstacle(CollisionMesh(boxMesh2, boxBounds2, glm::vec3(-2.0f, 0.4f, 2.0f)));
+    // Мир подгружается чанками вокруг персонажа; исходные препятствия закреплены за своими чанками.
+    // Без окна чанки загружаются синхронно, чтобы кадры в файлах повторялись от запуска к запуску
+    WorldConfig worldConfig;
+    worldConfig.synchronous = headless;
+    ChunkWorld world(worldConfig);
+    world.addStaticObstacle({ ChunkWorld::CUBE_MESH, ObstacleType::Wall, glm::vec3(0.0f, 1.0f, 5.0f),
+        glm::vec3(8.0f, 2.0f, 0.3f), glm::vec3(0.5f, 0.3f, 0.1f),
+        BoundingBox(glm::vec3(-4.0f, 0.0f, -0.15f), glm::vec3(4.0f, 2.0f, 0.15f)) });
+    world.addStaticObstacle({ ChunkWorld::CUBE_MESH, ObstacleType::Box, glm::vec3(3.0f, 0.5f, -3.0f),
+        glm::vec3(1.5f, 1.0f, 1.5f), glm::vec3(0.8f, 0.6f, 0.2f),
+        BoundingBox(glm::vec3(-0.75f, 0.0f, -0.75f), glm::vec3(0.75f, 1.0f, 0.75f)) });
+    world.addStaticObstacle({ ChunkWorld::CUBE_MESH, ObstacleType::Box, glm::vec3(-2.0f, 0.4f, 2.0f),
+        glm::vec3(1.0f, 0.8f, 1.0f), glm::vec3(0.4f, 0.2f, 0.8f),
+        BoundingBox(glm::vec3(-0.5f, 0.0f, -0.5f), glm::vec3(0.5f, 0.8f, 0.5f)) });
+    if (!scenePath.empty() && !world.loadScene(scenePath)) {
+        std::cerr << "Failed to load scene: " << scenePath << "\n";
+    }
 
     std::cout << "\n3D CHARACTER" << std::endl;
     std::cout << "Controls:" << std::endl;
@@ -679,22 +1984,51 @@ int main() {
     std::cout << "ESC - Exit" << std::endl;
 
 
-    // Main loop
-    while (!glfwWindowShouldClose(window)) {
-        float currentFrame = static_cast<float>(glfwGetTime());
+    // Временная память кадра: команды очереди, списки видимых, палитра костей
+    FrameArena frameArena;
+
+    InputTimeline inputTimeline;
+    InputLatency inputLatency;
+    double lastFrameTime = 0.0;
+    double latencyReportTime = 0.0;
+    int latencyReportFrames = 0;
+    bool loadingReported = false;
+
+    // Один кадр: ввод, симуляция и отрисовка. С окном кадры идут в своём потоке,
+    // без окна - заданное число раз подряд
+    int frameIndex = 0;
+    auto runFrame = [&]() {
+        // Без окна время идёт фиксированным шагом 1/60 с, чтобы последовательность кадров повторялась
+        double frameTime = headless ? frameIndex / 60.0 : glfwGetTime();
+        float currentFrame = static_cast<float>(frameTime);
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
         animationTime += deltaTime;
 
-        processInput(window, collisionSystem);
+        // Цель рендера текущего масштаба; замер кадра начинается здесь
+        dynamicResolution.beginFrame();
+        if (headless) frameCapture.beginFrame();
+        int renderWidth = dynamicResolution.renderWidth();
+        int renderHeight = dynamicResolution.renderHeight();
+
+        if (window) {
+            inputLatency.poll();
+            consumeInput(inputQueue, inputTimeline, inputLatency, lastFrameTime, frameTime);
+            processInput(window, inputTimeline, collisionSystem);
+        }
+        lastFrameTime = frameTime;
+        world.update(characterPos, collisionSystem);
 
         // Улучшенная физика прыжка с приземлением
         static float landingSquatCurrent = 0.0f;
 
         if (isJumping && !isCrawling) {
-            jumpAnimationTime += deltaTime;
-            characterHeight += jumpVelocity * deltaTime;
-            jumpVelocity += gravity * deltaTime;
+            // В шаге, где прыжок начался, физика идёт только с момента нажатия
+            float jumpDelta = jumpStepTime >= 0.0f ? jumpStepTime : deltaTime;
+            jumpStepTime = -1.0f;
+            jumpAnimationTime += jumpDelta;
+            characterHeight += jumpVelocity * jumpDelta;
+            jumpVelocity += gravity * jumpDelta;
 
             // Анимации прыжка
             if (jumpVelocity > 0.0f) {
@@ -764,11 +2098,38 @@ int main() {
         shader.setVec3("lightPos", glm::vec3(5.0f, 10.0f, 5.0f));
         shader.setVec3("lightColor", glm::vec3(1.0f, 1.0f, 1.0f));
 
-        // Draw floor
-        drawMesh(shader, floor, glm::mat4(1.0f));
+        // Точечные источники: раскладка по кластерам на CPU и загрузка списков
+        auto clusterStart = std::chrono::steady_clock::now();
+        updateBenchmarkLights(benchmarkLights, pointLights, animationTime);
+        clusteredLights.assign(pointLights, view, projection, 0.1f, 100.0f, threadPool);
+        clusteredLights.bind(shader.ID, renderWidth, renderHeight);
+        double clusterMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - clusterStart).count();
+
+        if (benchmarkLightCount > 0) {
+            static double statsTime = 0.0, statsClusterMs = 0.0;
+            static int statsFrames = 0;
+            statsTime += deltaTime;
+            statsClusterMs += clusterMs;
+            statsFrames++;
+            if (statsTime >= 2.0) {
+                std::cout << "Lights: " << pointLights.size() << ", cluster assignment " << statsClusterMs / statsFrames
+                    << " ms, frame " << statsTime * 1000.0 / statsFrames << " ms, max " << clusteredLights.maxLightsInCluster()
+                    << " lights/cluster, " << clusteredLights.indexCount() << " indices" << std::endl;
+                statsTime = statsClusterMs = 0.0;
+                statsFrames = 0;
+            }
+        }
+
+        frameArena.reset();
+        renderQueue.begin(frameArena);
+        renderQueue.setLodCamera(cameraPos, projection, static_cast<float>(renderHeight));
+
+        // Draw terrain chunks
+        Frustum viewFrustum(projection * view);
+        world.draw(renderQueue, viewFrustum);
 
         // Draw obstacles
-        collisionSystem.drawObstacles(shader);
+        collisionSystem.drawObstacles(renderQueue, viewFrustum, frameArena);
 
         // Основные анимации с учетом всех состояний
         float walkCycleSpeed = isRunning ? 12.0f : 8.0f;
@@ -808,7 +2169,6 @@ int main() {
         torsoTransform = glm::translate(torsoTransform, glm::vec3(0.0f, 0.3f + breathing - squatOffset - landingSquat, 0.0f));
         // Наклон вперед при ползании
         torsoTransform = glm::rotate(torsoTransform, glm::radians(torsoLean + forwardLean), glm::vec3(1, 0, 0));
-        drawMesh(shader, torso, torsoTransform);
 
         // Head с микродвижениями + анимации прыжка - УЛУЧШЕННЫЙ НАКЛОН
         glm::mat4 headTransform = torsoTransform;
@@ -817,7 +2177,6 @@ int main() {
         float headCompensation = -forwardLean * -0.4f; // УВЕЛИЧЕНО с 0.7f до 0.9f
         headTransform = glm::translate(headTransform, glm::vec3(0.0f, 0.2f + headBob + apexTuck, 0.0f));
         headTransform = glm::rotate(headTransform, glm::radians(headJumpTilt + headCompensation), glm::vec3(1, 0, 0));
-        drawMesh(shader, head, headTransform);
 
         // Arms с анимациями прыжка - УЛУЧШЕННЫЙ НАКЛОН
         glm::mat4 leftArmTransform = characterBaseWithLean;
@@ -837,7 +2196,6 @@ int main() {
             leftArmTransform = glm::rotate(leftArmTransform, glm::radians(leftArmRotation), glm::vec3(1, 0, 0));
             leftArmTransform = glm::rotate(leftArmTransform, glm::radians(10.0f), glm::vec3(0, 0, 1));
         }
-        drawMesh(shader, leftArm, leftArmTransform);
 
         glm::mat4 rightArmTransform = characterBaseWithLean;
 
@@ -856,7 +2214,6 @@ int main() {
             rightArmTransform = glm::rotate(rightArmTransform, glm::radians(rightArmRotation), glm::vec3(1, 0, 0));
             rightArmTransform = glm::rotate(rightArmTransform, glm::radians(-10.0f), glm::vec3(0, 0, 1));
         }
-        drawMesh(shader, rightArm, rightArmTransform);
 
         // Legs с анимациями прыжка
         glm::mat4 leftLegTransform = characterBaseWithLean;
@@ -875,7 +2232,6 @@ int main() {
             leftLegTransform = glm::rotate(leftLegTransform, glm::radians(leftLegRotation), glm::vec3(1, 0, 0));
             leftLegTransform = glm::translate(leftLegTransform, glm::vec3(0.0f, -0.3f, 0.0f));
         }
-        drawMesh(shader, leftLeg, leftLegTransform);
 
         glm::mat4 rightLegTransform = characterBaseWithLean;
 
@@ -893,12 +2249,157 @@ int main() {
             rightLegTransform = glm::rotate(rightLegTransform, glm::radians(rightLegRotation), glm::vec3(1, 0, 0));
             rightLegTransform = glm::translate(rightLegTransform, glm::vec3(0.0f, -0.3f, 0.0f));
         }
-        drawMesh(shader, rightLeg, rightLegTransform);
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        if (skinnedBiped) {
+            // Один вызов на персонажа: палитра костей вместо шести отдельных мешей
+            const glm::mat4* partTransforms[BIPED_JOINT_COUNT] = {
+                &torsoTransform, &headTransform, &leftArmTransform, &rightArmTransform, &leftLegTransform, &rightLegTransform
+            };
+            glm::mat4* palette = frameArena.allocate<glm::mat4>(BIPED_JOINT_COUNT);
+            for (int j = 0; j < BIPED_JOINT_COUNT; j++) {
+                palette[j] = bipedJointMatrix(bipedJoints()[j], characterBase, *partTransforms[j]);
+            }
+            renderQueue.submitSkinned(biped, palette, bipedColors, BIPED_JOINT_COUNT);
+        }
+        else {
+            drawMesh(renderQueue, torso, torsoTransform, &torsoLod);
+            drawMesh(renderQueue, head, headTransform, &headLod);
+            drawMesh(renderQueue, leftArm, leftArmTransform, &leftArmLod);
+            drawMesh(renderQueue, rightArm, rightArmTransform, &rightArmLod);
+            drawMesh(renderQueue, leftLeg, leftLegTransform, &leftLegLod);
+            drawMesh(renderQueue, rightLeg, rightLegTransform, &rightLegLod);
+        }
+
+        // Толпа: ближние - геометрия, дальние - импостеры, в полосе перехода - оба с дизерингом
+        if (!crowd.empty()) {
+            float fadeStart = crowdConfig.impostorDistance - crowdConfig.fadeBand;
+            uint32_t* order = frameArena.allocate<uint32_t>(crowd.size());
+            float* distances = frameArena.allocate<float>(crowd.size());
+            size_t visibleCount = 0;
+            for (uint32_t i = 0; i < crowd.size(); i++) {
+                BoundingBox bounds(crowd[i].position + crowdMemberBounds.min, crowd[i].position + crowdMemberBounds.max);
+                if (!viewFrustum.intersects(bounds)) continue;
+                distances[i] = glm::length(crowd[i].position - cameraPos);
+                order[visibleCount++] = i;
+            }
+            // Ближние первыми: лимит геометрии достаётся им
+            std::sort(order, order + visibleCount, [&](uint32_t a, uint32_t b) { return distances[a] < distances[b]; });
+
+            glm::mat4* bases = frameArena.allocate<glm::mat4>(visibleCount);
+            glm::mat4* poses = frameArena.allocate<glm::mat4>(visibleCount * BIPED_JOINT_COUNT);
+            int opaqueCount = 0, fadingCount = 0, impostorCount = 0, skippedCount = 0;
+            if (impostors.ready()) impostors.begin();
+            for (size_t k = 0; k < visibleCount; k++) {
+                const CrowdMember& member = crowd[order[k]];
+                float phase = animationTime * 8.0f + member.phaseOffset;
+                bool overBudget = opaqueCount + fadingCount >= crowdConfig.maxGeometry;
+                float impostorShare = 0.0f;
+                if (impostors.ready()) {
+                    impostorShare = glm::clamp((distances[order[k]] - fadeStart) / crowdConfig.fadeBand, 0.0f, 1.0f);
+                    if (overBudget) impostorShare = 1.0f;
+                }
+                else if (overBudget) {
+                    // Без атласа дальних заменить нечем - они не рисуются
+                    skippedCount++;
+                    continue;
+                }
+
+                if (impostorShare < 1.0f) {
+                    glm::mat4 base = glm::rotate(glm::translate(glm::mat4(1.0f), member.position),
+                        glm::radians(member.yaw), glm::vec3(0, 1, 0));
+                    if (impostorShare > 0.0f) {
+                        glm::mat4 fadingPose[BIPED_JOINT_COUNT];
+                        walkPose(base, phase, fadingPose);
+                        submitCharacters(renderQueue, characterModel, &base, fadingPose, 1, 1.0f - impostorShare, frameArena);
+                        fadingCount++;
+                    }
+                    else {
+                        bases[opaqueCount] = base;
+                        walkPose(base, phase, poses + opaqueCount * BIPED_JOINT_COUNT);
+                        opaqueCount++;
+                    }
+                }
+                if (impostorShare > 0.0f) {
+                    impostors.add(member.position, glm::radians(member.yaw), ImpostorAtlas::poseForPhase(phase), impostorShare);
+                    impostorCount++;
+                }
+            }
+            submitCharacters(renderQueue, characterModel, bases, poses, opaqueCount, 1.0f, frameArena);
+
+            static double crowdStatsTime = 0.0;
+            crowdStatsTime += deltaTime;
+            if (crowdStatsTime >= 2.0) {
+                std::cout << "Crowd: " << opaqueCount + fadingCount << " geometry (" << fadingCount << " crossfading), "
+                    << impostorCount << " impostors, " << crowd.size() - visibleCount << " culled, "
+                    << skippedCount << " over geometry budget" << std::endl;
+                crowdStatsTime = 0.0;
+            }
+        }
+
+        renderQueue.flush();
+        if (impostors.ready()) {
+            impostors.draw(view, projection, cameraPos, glm::vec3(5.0f, 10.0f, 5.0f), glm::vec3(1.0f, 1.0f, 1.0f));
+        }
+        dynamicResolution.endFrame();
+
+        if (headless) {
+            frameCapture.endFrame();
+        }
+        else {
+            glfwSwapBuffers(window);
+            inputLatency.frameSubmitted();
+
+            latencyReportFrames++;
+            if (frameTime - latencyReportTime >= 5.0) {
+                inputLatency.report(frameTime - latencyReportTime, latencyReportFrames, inputQueue.dropped());
+                latencyReportTime = frameTime;
+                latencyReportFrames = 0;
+            }
+        }
+        // Отчёт, когда загрузятся все чанки вокруг начальной позиции: запросов нет и ничего не в пути
+        if (!loadingReported && world.isSettled()) {
+            reportGeometryMemory("after loading");
+            loadingReported = true;
+        }
+        frameIndex++;
+    };
+
+    // Main loop
+    if (window) {
+        // Поток окна только ждёт события: колбэк ставит метку времени сразу при пробуждении,
+        // а не раз в кадр. Кадры рисуются в отдельном потоке, ему передаётся контекст
+        glfwMakeContextCurrent(nullptr);
+        std::thread frameThread([&]() {
+            glfwMakeContextCurrent(window);
+            while (!glfwWindowShouldClose(window)) {
+                runFrame();
+            }
+            glfwMakeContextCurrent(nullptr);
+            glfwPostEmptyEvent();
+        });
+        while (!glfwWindowShouldClose(window)) {
+            glfwWaitEvents();
+        }
+        frameThread.join();
+        glfwMakeContextCurrent(window);
+        inputLatency.destroy();
+    }
+    else {
+        while (frameIndex < headlessFrames) {
+            runFrame();
+        }
     }
 
-    glfwTerminate();
+    frameCapture.finish();
+    reportGeometryMemory("at exit");
+    std::cout << "Frame arena: peak " << frameArena.peakBytes() / 1024 << " KB of "
+        << frameArena.capacity() / 1024 << " KB" << std::endl;
+
+    world.shutdown(&collisionSystem);
+    dynamicResolution.destroy();
+    clusteredLights.destroy();
+    impostors.destroy();
+    renderQueue.destroy();
+    if (window) glfwTerminate();
     return 0;
 }
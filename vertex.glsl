@@ -1,16 +1,36 @@
 #version 330 core
 layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec3 aNormal;
+layout(location = 2) in uint aJoint;
 
-uniform mat4 model;
+// Данные объектов кадра из кольцевого буфера (см. RenderQueue)
+struct ObjectData {
+    mat4 model;
+    vec4 color;
+};
+
+layout(std140) uniform ObjectBlock {
+    ObjectData objects[128];
+};
+
+uniform int objectIndex;
+// Скиннинг: у экземпляра своя палитра из instanceStride записей, вершина выбирает кость по aJoint.
+// Жёсткие меши рисуются одним экземпляром с aJoint = 0
+uniform int instanceStride;
 uniform mat4 view;
 uniform mat4 projection;
 
 out vec3 FragPos;
 out vec3 Normal;
+flat out vec3 ObjectColor;
+flat out float ObjectFade;
 
 void main() {
+    int index = objectIndex + gl_InstanceID * instanceStride + int(aJoint);
+    mat4 model = objects[index].model;
     FragPos = vec3(model * vec4(aPos, 1.0));
     Normal = mat3(transpose(inverse(model))) * aNormal;
+    ObjectColor = objects[index].color.rgb;
+    ObjectFade = objects[index].color.a;
     gl_Position = projection * view * vec4(FragPos, 1.0);
-}
\ No newline at end of file
+}